@@ -0,0 +1,92 @@
+/**
+ * @file   arm.h
+ *
+ * @brief  Cortex-M4 helpers for critical sections and lock-free queues
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _ARM_H_
+#define _ARM_H_
+
+#include <unistd.h>
+
+/**
+ * @brief mask interrupts
+ *
+ * @return the previous PRIMASK, hand it to irq_restore()
+ */
+static inline uint32_t irq_save(void) {
+    uint32_t primask;
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+    return primask;
+}
+
+/**
+ * @brief restore the interrupt mask saved by irq_save()
+ *
+ * @param primask  value returned by irq_save()
+ */
+static inline void irq_restore(uint32_t primask) {
+    __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+
+/**
+ * @brief load a word and open an exclusive access to it
+ */
+static inline uint32_t ldrex(volatile uint32_t *addr) {
+    uint32_t value;
+    __asm volatile ("ldrex %0, [%1]" : "=r" (value) : "r" (addr) : "memory");
+    return value;
+}
+
+/**
+ * @brief store a word if nothing broke the exclusive access since ldrex()
+ *
+ * @return 0 when the store happened, 1 when ldrex() has to be retried
+ */
+static inline uint32_t strex(uint32_t value, volatile uint32_t *addr) {
+    uint32_t failed;
+    __asm volatile ("strex %0, %1, [%2]" : "=&r" (failed) : "r" (value), "r" (addr) : "memory");
+    return failed;
+}
+
+/**
+ * @brief give up an exclusive access opened by ldrex() without storing
+ */
+static inline void clrex(void) {
+    __asm volatile ("clrex" ::: "memory");
+}
+
+/**
+ * @brief add to a word that other contexts update too
+ */
+static inline void atomic_add(volatile uint32_t *addr, uint32_t n) {
+    uint32_t value;
+    do {
+        value = ldrex(addr) + n;
+    } while (strex(value, addr));
+}
+
+/**
+ * @brief tell an exception handler from thread code
+ *
+ * @return 1 in a handler, 0 in thread mode
+ */
+static inline int in_handler(void) {
+    uint32_t ipsr;
+    __asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+    return ipsr != 0;
+}
+
+/**
+ * @brief data memory barrier, orders a payload write before the index
+ * that publishes it in a lock-free queue
+ */
+static inline void dmb(void) {
+    __asm volatile ("dmb" ::: "memory");
+}
+
+#endif /* _ARM_H_ */
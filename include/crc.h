@@ -0,0 +1,61 @@
+/**
+ * @file   crc.h
+ *
+ * @brief  CRC-32/MPEG-2 on the CRC unit, by DMA, or in software
+ *
+ * The CRC unit takes one 32 bit word at a time, most significant bit
+ * first: polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no reflection
+ * and no final xor. Every path here gives the same result, so a value
+ * computed by one can be checked by another or by the host.
+ *
+ * Byte buffers are read as little endian words with the last one zero
+ * padded, the way the CPU loads them, see crc_bytes().
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _CRC_H_
+#define _CRC_H_
+
+#include <unistd.h>
+
+/** @brief value of the CRC before any data */
+#define CRC_INIT (0xFFFFFFFF)
+
+/** @brief cycles to checksum CRC_BENCH_BYTES, see crc_bench() */
+typedef struct {
+    /** @brief bytes checksummed by each path */
+    uint32_t bytes;
+    /** @brief table driven software loop */
+    uint32_t sw_cycles;
+    /** @brief CPU writing words to the CRC unit */
+    uint32_t hw_cycles;
+    /** @brief DMA writing words to the CRC unit, start to completion */
+    uint32_t dma_cycles;
+    /** @brief 1 when the three paths agreed */
+    uint8_t match;
+} crc_bench_t;
+
+void crc_init(void);
+
+int crc_start(void);
+
+void crc_feed(const uint32_t *words, uint32_t count);
+
+uint32_t crc_value(void);
+
+uint32_t crc_words(const uint32_t *words, uint32_t count);
+
+uint32_t crc_bytes(const void *data, uint32_t len);
+
+uint32_t crc_sw(uint32_t crc, const uint32_t *words, uint32_t count);
+
+int crc_dma_start(const uint32_t *words, uint32_t count);
+
+int crc_dma_poll(uint32_t *crc);
+
+void crc_bench(crc_bench_t *result);
+
+#endif /* _CRC_H_ */
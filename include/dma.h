@@ -0,0 +1,97 @@
+/**
+ * @file   dma.h
+ *
+ * @brief  DMA1/DMA2 stream setup
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _DMA_H_
+#define _DMA_H_
+
+#include <unistd.h>
+
+/** @brief registers of one DMA stream */
+struct dma_stream_reg_map {
+    volatile uint32_t cr;     /**< 00 Configuration Register */
+    volatile uint32_t ndtr;   /**< 04 Number of Data Register */
+    volatile uint32_t par;    /**< 08 Peripheral Address Register */
+    volatile uint32_t m0ar;   /**< 0C Memory 0 Address Register */
+    volatile uint32_t m1ar;   /**< 10 Memory 1 Address Register */
+    volatile uint32_t fcr;    /**< 14 FIFO Control Register */
+};
+
+/** @brief The DMA controller register map. */
+struct dma_reg_map {
+    volatile uint32_t lisr;   /**< 00 Low Interrupt Status Register */
+    volatile uint32_t hisr;   /**< 04 High Interrupt Status Register */
+    volatile uint32_t lifcr;  /**< 08 Low Interrupt Flag Clear Register */
+    volatile uint32_t hifcr;  /**< 0C High Interrupt Flag Clear Register */
+    struct dma_stream_reg_map stream[8]; /**< 10-CC Streams 0-7 */
+};
+
+/** @brief CR stream enable */
+#define DMA_CR_EN       (1)
+/** @brief CR transfer error interrupt enable */
+#define DMA_CR_TEIE     (1 << 2)
+/** @brief CR half transfer interrupt enable */
+#define DMA_CR_HTIE     (1 << 3)
+/** @brief CR transfer complete interrupt enable */
+#define DMA_CR_TCIE     (1 << 4)
+/** @brief CR direction: peripheral to memory */
+#define DMA_CR_DIR_P2M  (0)
+/** @brief CR direction: memory to peripheral */
+#define DMA_CR_DIR_M2P  (1 << 6)
+/** @brief CR direction: memory to memory, DMA2 only, par is the source */
+#define DMA_CR_DIR_M2M  (2 << 6)
+/** @brief CR direction field */
+#define DMA_CR_DIR_MASK (3 << 6)
+/** @brief CR circular mode */
+#define DMA_CR_CIRC     (1 << 8)
+/** @brief CR peripheral address increment */
+#define DMA_CR_PINC     (1 << 9)
+/** @brief CR memory address increment */
+#define DMA_CR_MINC     (1 << 10)
+/** @brief CR peripheral data size: 32 bits (8 bits is 0) */
+#define DMA_CR_PSIZE_32 (2 << 11)
+/** @brief CR memory data size: 32 bits (8 bits is 0) */
+#define DMA_CR_MSIZE_32 (2 << 13)
+/** @brief CR priority: high */
+#define DMA_CR_PL_HIGH  (2 << 16)
+/** @brief CR channel (request) select, 0-7 */
+#define DMA_CR_CHSEL(n) ((uint32_t)(n) << 25)
+
+/** @brief FCR direct mode disable, the FIFO is used */
+#define DMA_FCR_DMDIS    (1 << 2)
+/** @brief FCR FIFO threshold: full */
+#define DMA_FCR_FTH_FULL (3)
+
+/** @brief stream status: FIFO error */
+#define DMA_FEIF  (1)
+/** @brief stream status: direct mode error */
+#define DMA_DMEIF (1 << 2)
+/** @brief stream status: transfer error */
+#define DMA_TEIF  (1 << 3)
+/** @brief stream status: half transfer */
+#define DMA_HTIF  (1 << 4)
+/** @brief stream status: transfer complete */
+#define DMA_TCIF  (1 << 5)
+/** @brief every stream status flag */
+#define DMA_ALL_FLAGS (DMA_FEIF | DMA_DMEIF | DMA_TEIF | DMA_HTIF | DMA_TCIF)
+
+struct dma_stream_reg_map *dma_stream(int dma, int stream);
+
+void dma_init(int dma);
+
+void dma_stream_start(int dma, int stream, uint32_t cr, volatile void *periph,
+                      const volatile void *mem, uint16_t count);
+
+void dma_stream_stop(int dma, int stream);
+
+uint32_t dma_flags(int dma, int stream);
+
+void dma_clear_flags(int dma, int stream, uint32_t flags);
+
+#endif /* _DMA_H_ */
@@ -0,0 +1,42 @@
+/**
+ * @file   dwt.h
+ *
+ * @brief  DWT cycle counter, for timing interrupts and benchmarks
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _DWT_H_
+#define _DWT_H_
+
+#include <unistd.h>
+
+/** @brief DWT cycle counter */
+#define DWT_CYCCNT  (*(volatile uint32_t *) 0xE0001004)
+/** @brief DWT control register */
+#define DWT_CTRL    (*(volatile uint32_t *) 0xE0001000)
+/** @brief debug exception and monitor control register */
+#define DEMCR       (*(volatile uint32_t *) 0xE000EDFC)
+/** @brief DEMCR: enable the DWT and ITM units */
+#define DEMCR_TRCENA (1 << 24)
+/** @brief DWT_CTRL: enable the cycle counter */
+#define DWT_CTRL_CYCCNTENA (1)
+
+/**
+ * @brief start the cycle counter, harmless to call more than once
+ */
+static inline void dwt_init(void) {
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+
+/**
+ * @brief CPU cycles since dwt_init(), wraps every ~268 s at 16 MHz
+ */
+static inline uint32_t dwt_cycles(void) {
+    return DWT_CYCCNT;
+}
+
+#endif /* _DWT_H_ */
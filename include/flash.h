@@ -0,0 +1,27 @@
+/**
+ * @file   flash.h
+ *
+ * @brief  on-chip flash erase and program
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _FLASH_H_
+#define _FLASH_H_
+
+#include <unistd.h>
+
+/** @brief first address of the sector reserved for configuration (sector 7) */
+#define FLASH_CONFIG_BASE   (0x08060000)
+/** @brief sector number of FLASH_CONFIG_BASE */
+#define FLASH_CONFIG_SECTOR (7)
+/** @brief size of the configuration sector */
+#define FLASH_CONFIG_SIZE   (128 * 1024)
+
+int flash_erase_sector(uint8_t sector);
+
+int flash_program(uint32_t addr, const uint32_t *data, uint32_t words);
+
+#endif /* _FLASH_H_ */
@@ -80,6 +80,12 @@ void gpio_set(gpio_port port, unsigned int num);
  */
 void gpio_clr(gpio_port port, unsigned int num);
 
+/*
+ * gpio_write_bsrr: Set (bits 0-15) and clear (bits 16-31) pins of one port
+ * in a single write.
+ */
+void gpio_write_bsrr(gpio_port port, uint32_t mask);
+
 /*
  * gpio_read: Read from selected GPIO pin.
  */
@@ -0,0 +1,37 @@
+/**
+ * @file   itm.h
+ *
+ * @brief  ITM stimulus ports over SWO, a trace channel beside the console
+ *
+ * printk() uses it when built with make PRINTK_OUT=itm and LOG() records
+ * with make LOG_OUT=itm; make swo shows the output on the host.
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _ITM_H_
+#define _ITM_H_
+
+#include <unistd.h>
+
+/** @brief stimulus port of printk() text, one byte per packet */
+#define ITM_PORT_PRINTK (0)
+/** @brief stimulus port of LOG() records, packed in words */
+#define ITM_PORT_LOG    (1)
+
+/** @brief SWO bit rate, make swo has to capture at the same rate */
+#ifndef SWO_BAUD
+#define SWO_BAUD (2000000)
+#endif
+
+void itm_init(uint32_t swo_baud);
+
+int itm_enabled(uint8_t port);
+
+void itm_puts(uint8_t port, const char *ptr, size_t len);
+
+void itm_write(uint8_t port, const void *ptr, size_t len);
+
+#endif /* _ITM_H_ */
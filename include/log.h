@@ -0,0 +1,183 @@
+/**
+ * @file   log.h
+ *
+ * @brief  LOG(), printk() that can defer formatting to the host
+ *
+ * Built with make LOG=text (the default), LOG() is printk(). Built with
+ * make LOG=bin, the format string goes into the .logstr section, which is
+ * kept in the ELF but never loaded, and LOG() sends a record instead of
+ * text:
+ *
+ *   byte 0      LOG_SYNC | number of arguments (0-7)
+ *   bytes 1-2   offset of the format string in .logstr, little endian
+ *   bytes 3-6   systick time in ms, little endian
+ *   then        every argument as 4 little endian bytes
+ *
+ * The sync byte is never ASCII, so records and ordinary console text can
+ * share the port. util/logdecode.py turns the stream back into text with
+ * the ELF of the build (make decode).
+ *
+ * Arguments must be 32 bit or smaller, so %ll is not available; a wider
+ * argument fails to compile, in both builds. %s only decodes strings that
+ * are constants in flash, since the host reads them from the ELF.
+ *
+ * LOG_ERROR() to LOG_DEBUG() are LOG() behind a level fixed at compile
+ * time. A module picks its level by defining LOG_MODULE_LEVEL before it
+ * includes this header, normally from its own LOG_LEVEL_<MODULE> so that
+ * make LOG_MODULES="SERVO=4" can change it; otherwise LOG_LEVEL (make
+ * LOG_LEVEL=) applies. A message above the level is not compiled at all,
+ * its arguments are only type checked.
+ *
+ * The _RL forms also pass a token bucket kept per call site: up to burst
+ * messages at once, refilled at per_s messages per second. Messages
+ * without a token are dropped and counted by log_suppressed().
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include <unistd.h>
+#include <printk.h>
+
+/** @brief first byte of a record, the low 3 bits carry the argument count */
+#define LOG_SYNC     (0xF8)
+/** @brief most arguments a record carries */
+#define LOG_ARGS_MAX (7)
+
+/** @brief number of arguments after the format, 0-7 */
+#define LOG_NARGS(...) LOG_NARGS_(_, ##__VA_ARGS__, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NARGS_(_, a1, a2, a3, a4, a5, a6, a7, n, ...) n
+
+/** @brief 1 when any of the n arguments is wider than 32 bit */
+#define LOG_WIDE(n, ...) LOG_WIDE_(n, ##__VA_ARGS__)
+#define LOG_WIDE_(n, ...) LOG_WIDE_##n(__VA_ARGS__)
+#define LOG_WIDE_0(...) 0
+#define LOG_WIDE_1(a) (sizeof(a) > 4)
+#define LOG_WIDE_2(a, ...) (LOG_WIDE_1(a) | LOG_WIDE_1(__VA_ARGS__))
+#define LOG_WIDE_3(a, ...) (LOG_WIDE_1(a) | LOG_WIDE_2(__VA_ARGS__))
+#define LOG_WIDE_4(a, ...) (LOG_WIDE_1(a) | LOG_WIDE_3(__VA_ARGS__))
+#define LOG_WIDE_5(a, ...) (LOG_WIDE_1(a) | LOG_WIDE_4(__VA_ARGS__))
+#define LOG_WIDE_6(a, ...) (LOG_WIDE_1(a) | LOG_WIDE_5(__VA_ARGS__))
+#define LOG_WIDE_7(a, ...) (LOG_WIDE_1(a) | LOG_WIDE_6(__VA_ARGS__))
+
+/** @brief fails to compile when an argument does not fit a record */
+#define LOG_CHECK_ARGS(...) \
+    ((void)sizeof(char[LOG_WIDE(LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__) ? -1 : 1]))
+
+#ifdef LOG_BINARY
+
+/**
+ * @brief log a message, formatted by the host
+ *
+ * @param fmt  string literal, printk() conversions
+ */
+#define LOG(fmt, ...) do { \
+    LOG_CHECK_ARGS(__VA_ARGS__); \
+    static const char log_fmt_[] __attribute__((section(".logstr"), used)) = fmt; \
+    log_record((uint16_t)(uint32_t)log_fmt_, LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__); \
+} while (0)
+
+#else
+
+/**
+ * @brief log a message, formatted here
+ *
+ * @param fmt  string literal, printk() conversions
+ */
+#define LOG(fmt, ...) do { \
+    LOG_CHECK_ARGS(__VA_ARGS__); \
+    printk(fmt, ##__VA_ARGS__); \
+} while (0)
+
+#endif /* LOG_BINARY */
+
+/** @brief message levels, a module logs everything at or below its level */
+#define LOG_LEVEL_NONE  (0)
+#define LOG_LEVEL_ERROR (1)
+#define LOG_LEVEL_WARN  (2)
+#define LOG_LEVEL_INFO  (3)
+#define LOG_LEVEL_DEBUG (4)
+
+/** @brief level of modules that do not pick one, set with make LOG_LEVEL= */
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_MODULE_LEVEL
+#define LOG_MODULE_LEVEL LOG_LEVEL
+#endif
+
+/**
+ * log_bucket_t:
+ * @brief token bucket of one rate limited call site
+ */
+typedef struct {
+    /** @brief tokens left, in thousandths */
+    uint32_t milli_tokens;
+    /** @brief systick time of the last refill */
+    uint32_t last_ms;
+} log_bucket_t;
+
+/** @brief expand the LOG_ON_* switch first, then pick LOG_IF_0 or LOG_IF_1 */
+#define LOG_IF_(on, ...) LOG_IF__(on, __VA_ARGS__)
+#define LOG_IF__(on, ...) LOG_IF_##on(__VA_ARGS__)
+#define LOG_RL_IF_(on, ...) LOG_RL_IF__(on, __VA_ARGS__)
+#define LOG_RL_IF__(on, ...) LOG_RL_IF_##on(__VA_ARGS__)
+
+#define LOG_IF_1(fmt, ...) LOG(fmt, ##__VA_ARGS__)
+#define LOG_IF_0(fmt, ...) ((void)sizeof(printk(fmt, ##__VA_ARGS__)))
+#define LOG_RL_IF_1(per_s, burst, fmt, ...) do { \
+    static log_bucket_t log_bucket_ = {(burst) * 1000, 0}; \
+    if (log_allow(&log_bucket_, (per_s), (burst))) { \
+        LOG(fmt, ##__VA_ARGS__); \
+    } \
+} while (0)
+#define LOG_RL_IF_0(per_s, burst, fmt, ...) ((void)sizeof(printk(fmt, ##__VA_ARGS__)))
+
+#if LOG_MODULE_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ON_ERROR 1
+#else
+#define LOG_ON_ERROR 0
+#endif
+
+#if LOG_MODULE_LEVEL >= LOG_LEVEL_WARN
+#define LOG_ON_WARN 1
+#else
+#define LOG_ON_WARN 0
+#endif
+
+#if LOG_MODULE_LEVEL >= LOG_LEVEL_INFO
+#define LOG_ON_INFO 1
+#else
+#define LOG_ON_INFO 0
+#endif
+
+#if LOG_MODULE_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_ON_DEBUG 1
+#else
+#define LOG_ON_DEBUG 0
+#endif
+
+/** @brief log at a level, see the file comment */
+#define LOG_ERROR(fmt, ...) LOG_IF_(LOG_ON_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)  LOG_IF_(LOG_ON_WARN, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)  LOG_IF_(LOG_ON_INFO, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(fmt, ...) LOG_IF_(LOG_ON_DEBUG, fmt, ##__VA_ARGS__)
+
+/** @brief log at a level, at most burst at once and per_s per second */
+#define LOG_ERROR_RL(per_s, burst, fmt, ...) LOG_RL_IF_(LOG_ON_ERROR, per_s, burst, fmt, ##__VA_ARGS__)
+#define LOG_WARN_RL(per_s, burst, fmt, ...)  LOG_RL_IF_(LOG_ON_WARN, per_s, burst, fmt, ##__VA_ARGS__)
+#define LOG_INFO_RL(per_s, burst, fmt, ...)  LOG_RL_IF_(LOG_ON_INFO, per_s, burst, fmt, ##__VA_ARGS__)
+#define LOG_DEBUG_RL(per_s, burst, fmt, ...) LOG_RL_IF_(LOG_ON_DEBUG, per_s, burst, fmt, ##__VA_ARGS__)
+
+void log_record(uint16_t id, int argc, ...);
+
+int log_allow(log_bucket_t *bucket, uint32_t per_s, uint32_t burst);
+
+uint32_t log_suppressed(void);
+
+#endif /* _LOG_H_ */
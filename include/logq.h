@@ -0,0 +1,29 @@
+/**
+ * @file   logq.h
+ *
+ * @brief  log queue that interrupt handlers can write to
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _LOGQ_H_
+#define _LOGQ_H_
+
+#include <unistd.h>
+
+/** @brief slots in the queue, a power of two */
+#define LOGQ_SLOTS    (16)
+/** @brief longest message a slot holds, longer ones are cut */
+#define LOGQ_DATA_MAX (62)
+
+int logq_put(const void *data, int len);
+
+const char *logq_peek(int *len);
+
+void logq_pop(void);
+
+uint32_t logq_dropped(void);
+
+#endif /* _LOGQ_H_ */
@@ -23,7 +23,20 @@ struct nvic_t {
 #define IRQ_ENABLE 1
 #define IRQ_DISABLE 0
 
+/* interrupt control and state register */
+#define SCB_ICSR (*(volatile uint32_t *) 0xE000ED04)
+/* ICSR: make PendSV pending */
+#define ICSR_PENDSVSET (1 << 28)
+/* system handler priority register 3, PendSV priority in bits 23:16 */
+#define SCB_SHPR3 (*(volatile uint32_t *) 0xE000ED20)
+/* lowest priority, the priority bits not implemented read as zero */
+#define PEND_SV_PRIORITY (0xFF << 16)
+
 void nvic_irq( uint8_t irq_num, uint8_t status );
 void nvic_clear_pending( uint8_t irq_num );
 
+void nvic_pend_sv_init( void );
+
+void nvic_pend_sv( void );
+
 #endif //_NVIC_H
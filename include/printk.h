@@ -10,6 +10,25 @@
 #ifndef _PRINTK_H_
 #define _PRINTK_H_
 
+#include <unistd.h>
+#include <stdarg.h>
+
+/** @brief average cycles per decimal number, see printk_bench() */
+typedef struct {
+  /** @brief one division per digit, how printk() used to convert */
+  uint32_t div_cycles;
+  /** @brief two digits per reciprocal multiply, the current conversion */
+  uint32_t fast_cycles;
+  /** @brief a whole snprintk() of "%08lu" */
+  uint32_t snprintk_cycles;
+} printk_bench_t;
+
 int printk( const char *fmt, ... );
 
-#endif /* _PRINTK_H_ */
\ No newline at end of file
+int snprintk( char *buf, size_t size, const char *fmt, ... );
+
+int vsnprintk( char *buf, size_t size, const char *fmt, va_list args );
+
+void printk_bench( printk_bench_t *result );
+
+#endif /* _PRINTK_H_ */
@@ -0,0 +1,81 @@
+/**
+ * @file   proto.h
+ *
+ * @brief  binary servo command protocol on the console
+ *
+ * Every packet is COBS encoded and sent between two 0x00 bytes. Decoded,
+ * a request is
+ *
+ *   byte 0      sequence number, chosen by the host, echoed in the reply
+ *   byte 1      opcode, PROTO_OP_*
+ *   then        payload, multi-byte fields little endian
+ *   last 4      CRC of everything before, see crc_bytes(), continued
+ *               with the number of bytes before as one more word;
+ *               little endian
+ *
+ * and its reply carries the same sequence number, the opcode with
+ * PROTO_REPLY set, a PROTO_* status byte, the reply payload and the CRC.
+ * Requests are answered in the order they arrive, so a host can keep many
+ * in flight and match the replies by sequence number. Packets with a bad
+ * CRC or encoding are dropped without a reply; the host resends them.
+ *
+ * Channels are numbered from 0, unlike the text commands.
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _PROTO_H_
+#define _PROTO_H_
+
+#include <unistd.h>
+
+/** @brief longest decoded packet, CRC included */
+#define PROTO_PACKET_MAX (32)
+
+/** @brief no payload, the reply is empty, to measure latency */
+#define PROTO_OP_PING    (0x00)
+/** @brief ch u8 */
+#define PROTO_OP_ENABLE  (0x01)
+/** @brief ch u8 */
+#define PROTO_OP_DISABLE (0x02)
+/** @brief ch u8, position u16 in 0.1 degrees */
+#define PROTO_OP_SET     (0x03)
+/** @brief ch u8, angle u8 in degrees, vel u16, acc u16, jerk u16, see servo_move() */
+#define PROTO_OP_MOVE    (0x04)
+/** @brief ch u8, replies enabled u8, moving u8, position u16 in 0.1 degrees */
+#define PROTO_OP_QUERY   (0x05)
+/** @brief no payload, replies proto_stats_t as three u32 */
+#define PROTO_OP_STATS   (0x06)
+/** @brief no payload, back to the text console after the reply */
+#define PROTO_OP_TEXT    (0x7F)
+/** @brief set in the opcode of a reply */
+#define PROTO_REPLY      (0x80)
+
+/** @brief request carried out */
+#define PROTO_OK         (0)
+/** @brief unknown opcode */
+#define PROTO_E_OPCODE   (1)
+/** @brief payload too short or too long for the opcode */
+#define PROTO_E_LENGTH   (2)
+/** @brief the servo driver refused the request */
+#define PROTO_E_REJECTED (3)
+
+/** @brief packet counters since boot, see proto_stats() */
+typedef struct {
+    /** @brief requests answered */
+    uint32_t requests;
+    /** @brief packets dropped for a bad CRC */
+    uint32_t crc_errors;
+    /** @brief packets dropped for a bad encoding or length */
+    uint32_t framing_errors;
+} proto_stats_t;
+
+void proto_start(void);
+
+int proto_poll(void);
+
+void proto_stats(proto_stats_t *stats);
+
+#endif /* _PROTO_H_ */
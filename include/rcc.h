@@ -2,6 +2,7 @@
 
 #ifndef _RCC_H_
 #define _RCC_H_
+#include <stdint.h>
 
 /** @brief The Reset and Clock Control (RCC) register map. */
 struct rcc_reg_map {
@@ -46,18 +47,43 @@ struct rcc_reg_map {
 /** @brief Base address of the RCC */
 #define RCC_BASE    (struct rcc_reg_map *) 0x40023800
 
+/** @brief internal RC oscillator frequency */
+#define HSI_HZ      (16000000)
+/** @brief external clock frequency, the ST-LINK MCO on the Nucleo board */
+#define HSE_HZ      (8000000)
+
 /** @brief UART's clock enable bit */
 #define UART_CLKEN  (1 << 17)
 
+/** @brief USART1 and USART6 clock enable bits (APB2) */
+#define USART1_CLKEN (1 << 4)
+#define USART6_CLKEN (1 << 5)
+
 /** @brief I2C's clock enable bit(p137) */
 #define I2C1_CLKEN  (1 << 21)
 #define I2C2_CLKEN  (1 << 22)
 #define I2C3_CLKEN  (1 << 23)
 
 
+/** @brief CRC unit clock enable bit (AHB1) */
+#define CRC_CLKEN   (1 << 12)
+
+/** @brief DMA1 and DMA2 clock enable bits (AHB1) */
+#define DMA1_CLKEN  (1 << 21)
+#define DMA2_CLKEN  (1 << 22)
+
 /** @brief TIM2 to 5's clock enable bit */
 #define TIM5_CLKEN  (1 << 3)
 #define TIM4_CLKEN  (1 << 2)
 #define TIM3_CLKEN  (1 << 1)
 #define TIM2_CLKEN  (1)
+
+uint32_t rcc_sysclk_hz(void);
+
+uint32_t rcc_hclk_hz(void);
+
+uint32_t rcc_apb1_hz(void);
+
+uint32_t rcc_apb2_hz(void);
+
 #endif /* _RCC_H_ */
\ No newline at end of file
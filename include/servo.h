@@ -11,8 +11,109 @@
 #ifndef _SERVO_H_
 #define _SERVO_H_
 
+#include <unistd.h>
+
+/** @brief number of servo channels provided by the selected backend */
+#ifdef SERVO_SCHED
+#define SERVO_CHANNELS (16)
+#else
+#define SERVO_CHANNELS (2)
+#endif
+
+/** @brief uncalibrated pulse width at 0 degree in us */
+#define SERVO_MIN_US (600)
+/** @brief uncalibrated pulse width at 180 degree in us */
+#define SERVO_MAX_US (2400)
+/** @brief largest angle in 0.1 degree steps */
+#define SERVO_DECIDEG_MAX (1800)
+/** @brief shortest pulse servo_set_us() accepts */
+#define SERVO_PULSE_MIN_US (500)
+/** @brief longest pulse servo_set_us() accepts */
+#define SERVO_PULSE_MAX_US (2500)
+/** @brief latest stream time servo_stream_push() accepts in ms, one day */
+#define SERVO_STREAM_MS_MAX (86400000)
+
+/** @brief pulse widths of one channel, see servo_cal_set() */
+typedef struct {
+    /** @brief pulse width at 0 degree in us */
+    uint16_t min_us;
+    /** @brief pulse width at 90 degree in us */
+    uint16_t center_us;
+    /** @brief pulse width at 180 degree in us */
+    uint16_t max_us;
+} servo_cal_t;
+
+/** @brief worst-case servo interrupt cost, see servo_isr_stats() */
+typedef struct {
+    /** @brief longest single servo interrupt in the last frame, cycles */
+    uint32_t last_isr_max;
+    /** @brief total servo interrupt time in the last frame, cycles */
+    uint32_t last_frame_total;
+    /** @brief worst frame total seen since boot, cycles */
+    uint32_t worst_frame_total;
+} servo_isr_stats_t;
+
+/** @brief setpoint stream counters, see servo_stream_stats() */
+typedef struct {
+    /** @brief setpoints accepted by servo_stream_push() */
+    uint32_t queued;
+    /** @brief setpoints applied by the servo interrupt */
+    uint32_t applied;
+    /** @brief setpoints already due when they were pushed */
+    uint32_t late;
+    /** @brief setpoints applied after the frame they were due in */
+    uint32_t underruns;
+    /** @brief setpoints rejected because the queue was full */
+    uint32_t overruns;
+    /** @brief setpoints waiting in the queue */
+    uint32_t pending;
+} servo_stream_stats_t;
+
+/** @brief what a channel is doing, see servo_get_state() */
+typedef struct {
+    /** @brief 1 when the channel is enabled */
+    uint8_t enabled;
+    /** @brief 1 while a servo_move() is in progress */
+    uint8_t moving;
+    /** @brief commanded position in 0.1 degrees */
+    uint16_t decideg;
+} servo_state_t;
+
+void servo_init(void);
+
 int servo_enable(uint8_t channel, uint8_t enabled);
 
 int servo_set(uint8_t channel, uint8_t angle);
 
+int servo_set_decideg(uint8_t channel, uint16_t decideg);
+
+int servo_set_us(uint8_t channel, uint16_t pulse_us);
+
+int servo_move(uint8_t channel, uint8_t angle, uint16_t max_vel, uint16_t max_acc, uint16_t max_jerk);
+
+int servo_move_group(uint8_t count, const uint8_t *channels, const uint8_t *angles,
+                     uint16_t max_vel, uint16_t max_acc, uint16_t max_jerk);
+
+int servo_move_done(uint8_t channel);
+
+int servo_get_state(uint8_t channel, servo_state_t *state);
+
+int servo_isr_stats(servo_isr_stats_t *stats);
+
+void servo_stream_start(uint32_t lead_ms);
+
+void servo_stream_stop(void);
+
+int servo_stream_push(uint8_t channel, uint16_t decideg, uint32_t time_ms);
+
+int servo_stream_stats(servo_stream_stats_t *out);
+
+int servo_cal_get(uint8_t channel, servo_cal_t *cal);
+
+int servo_cal_set(uint8_t channel, const servo_cal_t *cal);
+
+int servo_cal_can_save(void);
+
+int servo_cal_save(void);
+
 #endif /* _SERVO_H_ */
@@ -0,0 +1,100 @@
+/**
+ * @file servo_hw.h
+ *
+ * @brief interface between servo.c, its helpers and the pulse generating
+ * backend
+ *
+ * Exactly one backend is linked in: servo_sched.c when SERVO_SCHED is
+ * defined (make SERVO=sched), servo_pwm.c otherwise.
+ *
+ * @date 03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _SERVO_HW_H_
+#define _SERVO_HW_H_
+
+#include <unistd.h>
+#include <servo.h>
+
+/** @brief servo frame period in us (20 ms, 50 Hz) */
+#define SERVO_FRAME_US (20000)
+/** @brief timer prescalar giving one timer tick per us at 16 MHz */
+#define SERVO_PRESCALAR (16)
+
+/**
+ * @brief start or stop the pulse train on a channel
+ *
+ * @param channel  channel, already range checked
+ * @param enabled  1 to start, 0 to stop and hold the pin low
+ */
+void servo_hw_enable(uint8_t channel, uint8_t enabled);
+
+/**
+ * @brief set the pulse width of a channel, applied on the next frame
+ *
+ * @param channel  channel, already range checked
+ * @param pulse_us high time in us
+ */
+void servo_hw_set(uint8_t channel, uint16_t pulse_us);
+
+/**
+ * @brief advance the servo moves by one frame, implemented by servo.c
+ *
+ * The backend calls this from its timer interrupt once per frame, early
+ * enough that the widths it sets through servo_hw_set() go out in the
+ * following frame.
+ */
+void servo_frame(void);
+
+/**
+ * @brief apply the streamed setpoints due in this frame, implemented by
+ * servo_stream.c and called by servo_frame()
+ *
+ * @param frame  frame number, increments by one per call
+ */
+void servo_stream_frame(uint32_t frame);
+
+/**
+ * @brief output the position of a channel at rest again, implemented by
+ * servo.c and called after its calibration changed
+ *
+ * @param channel  channel, already range checked
+ */
+void servo_refresh(uint8_t channel);
+
+/**
+ * @brief load the calibration from flash, implemented by servo_cal.c
+ */
+void servo_cal_load(void);
+
+/**
+ * @brief whole degree (0-180) to pulse width in us, a table lookup
+ */
+uint16_t servo_cal_angle_us(uint8_t channel, uint8_t angle);
+
+/**
+ * @brief 0.1 degree (0-1800) to pulse width in us
+ */
+uint16_t servo_cal_decideg_us(uint8_t channel, uint16_t decideg);
+
+/**
+ * @brief Q16 0.1 degree motion position to pulse width in us, safe to
+ * call from the frame interrupt
+ */
+uint16_t servo_cal_pos_us(uint8_t channel, int32_t pos);
+
+/**
+ * @brief pulse width in us to the nearest angle in 0.1 degree
+ */
+uint16_t servo_cal_us_decideg(uint8_t channel, uint16_t pulse_us);
+
+/**
+ * @brief report the interrupt cost of the backend, zero if it takes none
+ *
+ * @param stats  destination, never NULL
+ */
+void servo_hw_isr_stats(servo_isr_stats_t *stats);
+
+#endif /* _SERVO_HW_H_ */
@@ -0,0 +1,74 @@
+/**
+ * @file   shell.h
+ *
+ * @brief  table driven text command shell
+ *
+ * A command is a shell_cmd_t: its name, an argument schema, and a handler
+ * that gets the arguments already checked and converted. Each character
+ * of the schema is one argument:
+ *
+ *   i   integer, decimal with an optional sign
+ *   w   word
+ *   I W the same, optional; only at the end of the schema
+ *
+ * A line holds any number of commands separated by ';', for example
+ * set 1 90; set 2 45; move 3 120 200. They run in order as the line is
+ * tokenized, and one that fails does not stop the rest.
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _SHELL_H_
+#define _SHELL_H_
+
+#include <unistd.h>
+
+/** @brief most arguments a command takes */
+#define SHELL_ARGS_MAX (8)
+
+/** @brief handler return value: the arguments were wrong, print the usage */
+#define SHELL_E_USAGE  (-2)
+
+/** @brief one argument, as the schema says */
+typedef union {
+    /** @brief for i and I */
+    int32_t i;
+    /** @brief for w and W, points into the line */
+    const char *s;
+} shell_arg_t;
+
+/**
+ * @brief run a command
+ *
+ * @param argc  arguments given, optional ones may be missing
+ * @param argv  the arguments
+ *
+ * @return 0 on success, -1 when the handler reported the failure itself,
+ * or SHELL_E_USAGE
+ */
+typedef int (*shell_handler_t)(int argc, const shell_arg_t *argv);
+
+/** @brief one command of the table given to shell_init() */
+typedef struct {
+    /** @brief name, the table is sorted by it with strcmp() */
+    const char *name;
+    /** @brief argument schema, see the file comment */
+    const char *schema;
+    /** @brief arguments as shown by help and on a usage error */
+    const char *usage;
+    /** @brief one line description for help */
+    const char *help;
+    shell_handler_t handler;
+} shell_cmd_t;
+
+int shell_init(const shell_cmd_t *commands, int count);
+
+int shell_run(char *line);
+
+void shell_help(void);
+
+int shell_parse_int(const char *str, int32_t *value);
+
+#endif /* _SHELL_H_ */
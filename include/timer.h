@@ -11,6 +11,24 @@
 #ifndef _TIMER_H_
 #define _TIMER_H_
 #define TIM_SR_UIF (1)
+/** @brief SR capture/compare 1 interrupt flag */
+#define TIM_SR_CC1IF (1 << 1)
+/** @brief DIER capture/compare 1 interrupt enable */
+#define TIM_DIER_CC1IE (1 << 1)
+/** @brief DIER update DMA request enable */
+#define TIM_DIER_UDE (1 << 8)
+/** @brief DCR base address of a burst starting at CCR1 (register 0x34 / 4) */
+#define TIM_DCR_CCR1 (13)
+/** @brief CR1 auto-reload preload enable */
+#define TIM_CR1_ARPE (1 << 7)
+/** @brief EGR update generation */
+#define TIM_EGR_UG (1)
+/** @brief CCMR output compare mode: PWM mode 1 */
+#define TIM_OCM_PWM1 (0x6)
+/** @brief CCMR output compare mode: force inactive level */
+#define TIM_OCM_FORCE_LOW (0x4)
+/** @brief CCMR output compare preload enable (relative to channel field) */
+#define TIM_OCPE (1 << 3)
 
 /** @brief tim2_5 */
 struct tim2_5 {
@@ -41,4 +59,16 @@ void timer_disable(int timer);
 
 void timer_clear_interrupt_bit(int timer);
 
+void timer_pwm_init(int timer, uint32_t prescalar, uint32_t period);
+
+void timer_update_irq(int timer, int enabled);
+
+void timer_pwm_channel(int timer, int channel, int enabled);
+
+void timer_set_compare(int timer, int channel, uint32_t value);
+
+void timer_compare_preload(int timer, int channel, int enabled);
+
+void timer_dma_burst(int timer, uint32_t base_reg, uint32_t count, int enabled);
+
 #endif /* _TIMER_H_ */
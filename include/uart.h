@@ -11,14 +11,84 @@
 #ifndef _UART_H_
 #define _UART_H_
 
+#include <stdint.h>
+
+/** @brief transmit ring size, a power of two, set with make UART_TX_SIZE= */
+#ifndef UART_TX_SIZE
+#define UART_TX_SIZE (1024)
+#endif
+
+/** @brief receive ring size, a power of two, set with make UART_RX_SIZE= */
+#ifndef UART_RX_SIZE
+#define UART_RX_SIZE (256)
+#endif
+
+/** @brief USART instances, see uart_hw[] in uart.c */
+typedef enum {UART_1 = 0, UART_2 = 1, UART_6 = 2, UART_PORTS} uart_port;
+
+/** @brief port behind printk() and the uart_* console functions */
+#define UART_CONSOLE UART_2
+
+/** @brief receive counters of a port since it was opened, see uart_port_stats() */
+typedef struct {
+    /** @brief bytes stored by the receive DMA */
+    uint32_t received;
+    /** @brief bytes overwritten in the receive ring before they were read */
+    uint32_t ring_full;
+    /** @brief input lines dropped because the line queue was full */
+    uint32_t lines_dropped;
+    /** @brief hardware overruns, each lost at least one byte */
+    uint32_t overrun;
+    /** @brief bytes received with a framing error */
+    uint32_t framing;
+    /** @brief bytes received with noise */
+    uint32_t noise;
+} uart_stats_t;
+
+int uart_port_init(uart_port port, uint32_t baud);
+
+int uart_port_set_baud(uart_port port, uint32_t baud, uint32_t *actual);
+
+uint32_t uart_port_get_baud(uart_port port);
+
+int uart_port_write(uart_port port, const char *ptr, int len);
+
+int uart_port_reserve(uart_port port, char **span, int len);
+
+void uart_port_commit(uart_port port, int len);
+
+int uart_port_get_byte(uart_port port, char *c);
+
+int uart_port_readline_nb(uart_port port, char *ptr, int len);
+
+void uart_port_line_mode(uart_port port, int enabled);
+
+int uart_port_flow_control(uart_port port, int enabled, uint16_t high_watermark);
+
+int uart_port_stats(uart_port port, uart_stats_t *stats);
+
+void uart_log_drain(void);
+
 void uart_init(int baud);
 
+int uart_set_baud(uint32_t baud, uint32_t *actual);
+
+uint32_t uart_get_baud(void);
+
 int uart_put_byte(char c);
 
 int uart_get_byte(char *c);
 
 int uart_write(int file, char *ptr, int len);
 
+int uart_write_reserve(char **span, int len);
+
+void uart_write_commit(int len);
+
 int uart_read(int file, char *ptr, int len);
 
+int uart_readline_nb(char *ptr, int len);
+
+void uart_line_mode(int enabled);
+
 #endif /* _UART_H_ */
@@ -0,0 +1,107 @@
+/**
+ * @file   uart_hw.h
+ *
+ * @brief  USART registers and the port descriptor table shared by the
+ *         interrupt (uart.c) and polling (uart_polling.c) drivers
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef _UART_HW_H_
+#define _UART_HW_H_
+
+#include <stdint.h>
+#include <gpio.h>
+#include <uart.h>
+
+/** @brief The UART register map. */
+struct uart_reg_map {
+    volatile uint32_t SR;   /**< Status Register */
+    volatile uint32_t DR;   /**<  Data Register */
+    volatile uint32_t BRR;  /**<  Baud Rate Register */
+    volatile uint32_t CR1;  /**<  Control Register 1 */
+    volatile uint32_t CR2;  /**<  Control Register 2 */
+    volatile uint32_t CR3;  /**<  Control Register 3 */
+    volatile uint32_t GTPR; /**<  Guard Time and Prescaler Register */
+};
+
+/** @brief Enable Bit for UART Config register */
+#define UART_EN         (1 << 13)
+
+/** @brief Enable Bit for Transmitter */
+#define UART_TE         (1 << 3)
+
+/** @brief Enable Bit for Receiver */
+#define UART_RE         (1 << 2)
+
+/** @brief CR1 oversampling by 8 instead of 16 */
+#define UART_CR1_OVER8  (1 << 15)
+
+/** @brief Transmit data register empty */
+#define UART_SR_TXE     (1 << 7)
+
+/** @brief Transmission complete */
+#define UART_SR_TC      (1 << 6)
+
+/** @brief Read data registter not empty */
+#define UART_SR_RXNE    (1 << 5)
+
+/** @brief Idle line detected */
+#define UART_SR_IDLE    (1 << 4)
+
+/** @brief Overrun, a byte arrived before the last one was read */
+#define UART_SR_ORE     (1 << 3)
+
+/** @brief Noise detected on a received byte */
+#define UART_SR_NF      (1 << 2)
+
+/** @brief Framing error, no stop bit where one was due */
+#define UART_SR_FE      (1 << 1)
+
+/**
+ * UartHw:
+ * @brief everything that differs between two USART instances
+ */
+typedef struct {
+    /** @brief register block */
+    struct uart_reg_map *base;
+    /** @brief USART interrupt number */
+    uint8_t irq;
+    /** @brief clock enable is in apb2_enr rather than apb1_enr */
+    uint8_t apb2;
+    /** @brief clock enable bit */
+    uint32_t clk_en;
+    /** @brief TX and RX pins and their alternate function */
+    gpio_port tx_port;
+    uint8_t tx_pin;
+    gpio_port rx_port;
+    uint8_t rx_pin;
+    uint8_t alt;
+    /** @brief the package brings out CTS and RTS */
+    uint8_t has_flow;
+    /** @brief CTS pin (alternate function alt) and RTS pin (driven as GPIO) */
+    gpio_port cts_port;
+    uint8_t cts_pin;
+    gpio_port rts_port;
+    uint8_t rts_pin;
+    /** @brief DMA controller, channel (shared by TX and RX) and streams */
+    uint8_t dma;
+    uint8_t dma_channel;
+    uint8_t tx_stream;
+    uint8_t rx_stream;
+    /** @brief interrupt numbers of the two streams */
+    uint8_t tx_dma_irq;
+    uint8_t rx_dma_irq;
+} UartHw;
+
+extern const UartHw uart_hw[UART_PORTS];
+
+void uart_hw_setup(uart_port port);
+
+int uart_hw_pins_free(uart_port port, int flow);
+
+int uart_hw_brr(uart_port port, uint32_t baud, uint32_t *brr, uint32_t *over8, uint32_t *actual);
+
+#endif /* _UART_HW_H_ */
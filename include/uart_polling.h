@@ -11,10 +11,12 @@
 #ifndef _UART_POLLING_H_
 #define _UART_POLLING_H_
 
-void uart_polling_init(int baud);
+#include <uart.h>
 
-void uart_polling_put_byte(char c);
+void uart_polling_init(uart_port port, int baud);
 
-char uart_polling_get_byte();
+void uart_polling_put_byte(uart_port port, char c);
+
+char uart_polling_get_byte(uart_port port);
 
 #endif /* _UART_POLLING_H_ */
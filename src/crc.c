@@ -0,0 +1,334 @@
+/**
+ * @file   crc.c
+ *
+ * @brief  CRC-32/MPEG-2 on the CRC unit, by DMA, or in software
+ *
+ * The CRC unit accumulates every word written to its data register, in
+ * about 4 AHB cycles, and crc_start() resets it. There is one unit, so the
+ * streaming functions and a DMA run cannot overlap: while DMA2 stream 0 is
+ * feeding it, crc_words() and crc_bytes() fall back to the table driven
+ * software loop and crc_start() fails. Thread context only.
+ *
+ * Built with make CRC=sw the CRC unit and the DMA are never touched and
+ * every function runs the software loop, for boards or host builds
+ * without the unit.
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <crc.h>
+#include <rcc.h>
+#include <dma.h>
+#include <dwt.h>
+
+/** @brief The CRC unit register map. */
+struct crc_reg_map {
+    volatile uint32_t DR;   /**< 00 Data Register */
+    volatile uint32_t IDR;  /**< 04 Independent Data Register */
+    volatile uint32_t CR;   /**< 08 Control Register */
+};
+
+/** @brief Base address of the CRC unit */
+#define CRC_BASE ((struct crc_reg_map *) 0x40023000)
+/** @brief CR: load CRC_INIT into the data register */
+#define CRC_CR_RESET (1)
+
+/** @brief memory to memory needs DMA2, stream 0 is not used elsewhere */
+#define CRC_DMA (2)
+#define CRC_DMA_STREAM (0)
+/** @brief most words one DMA transfer takes, NDTR is 16 bits */
+#define CRC_DMA_CHUNK (0xFFFF)
+
+/** @brief words crc_bytes() copies at a time */
+#define CRC_BYTES_CHUNK (8)
+
+/** @brief checksummed by crc_bench(): the start of the image in flash */
+#define CRC_BENCH_ADDR  (0x08000000)
+#define CRC_BENCH_BYTES (4096)
+
+/** @brief CRC of the top byte of the register, polynomial 0x04C11DB7 */
+static const uint32_t crc_table[256] = {
+    0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9, 0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
+    0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61, 0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD,
+    0x4C11DB70, 0x48D0C6C7, 0x4593E01E, 0x4152FDA9, 0x5F15ADAC, 0x5BD4B01B, 0x569796C2, 0x52568B75,
+    0x6A1936C8, 0x6ED82B7F, 0x639B0DA6, 0x675A1011, 0x791D4014, 0x7DDC5DA3, 0x709F7B7A, 0x745E66CD,
+    0x9823B6E0, 0x9CE2AB57, 0x91A18D8E, 0x95609039, 0x8B27C03C, 0x8FE6DD8B, 0x82A5FB52, 0x8664E6E5,
+    0xBE2B5B58, 0xBAEA46EF, 0xB7A96036, 0xB3687D81, 0xAD2F2D84, 0xA9EE3033, 0xA4AD16EA, 0xA06C0B5D,
+    0xD4326D90, 0xD0F37027, 0xDDB056FE, 0xD9714B49, 0xC7361B4C, 0xC3F706FB, 0xCEB42022, 0xCA753D95,
+    0xF23A8028, 0xF6FB9D9F, 0xFBB8BB46, 0xFF79A6F1, 0xE13EF6F4, 0xE5FFEB43, 0xE8BCCD9A, 0xEC7DD02D,
+    0x34867077, 0x30476DC0, 0x3D044B19, 0x39C556AE, 0x278206AB, 0x23431B1C, 0x2E003DC5, 0x2AC12072,
+    0x128E9DCF, 0x164F8078, 0x1B0CA6A1, 0x1FCDBB16, 0x018AEB13, 0x054BF6A4, 0x0808D07D, 0x0CC9CDCA,
+    0x7897AB07, 0x7C56B6B0, 0x71159069, 0x75D48DDE, 0x6B93DDDB, 0x6F52C06C, 0x6211E6B5, 0x66D0FB02,
+    0x5E9F46BF, 0x5A5E5B08, 0x571D7DD1, 0x53DC6066, 0x4D9B3063, 0x495A2DD4, 0x44190B0D, 0x40D816BA,
+    0xACA5C697, 0xA864DB20, 0xA527FDF9, 0xA1E6E04E, 0xBFA1B04B, 0xBB60ADFC, 0xB6238B25, 0xB2E29692,
+    0x8AAD2B2F, 0x8E6C3698, 0x832F1041, 0x87EE0DF6, 0x99A95DF3, 0x9D684044, 0x902B669D, 0x94EA7B2A,
+    0xE0B41DE7, 0xE4750050, 0xE9362689, 0xEDF73B3E, 0xF3B06B3B, 0xF771768C, 0xFA325055, 0xFEF34DE2,
+    0xC6BCF05F, 0xC27DEDE8, 0xCF3ECB31, 0xCBFFD686, 0xD5B88683, 0xD1799B34, 0xDC3ABDED, 0xD8FBA05A,
+    0x690CE0EE, 0x6DCDFD59, 0x608EDB80, 0x644FC637, 0x7A089632, 0x7EC98B85, 0x738AAD5C, 0x774BB0EB,
+    0x4F040D56, 0x4BC510E1, 0x46863638, 0x42472B8F, 0x5C007B8A, 0x58C1663D, 0x558240E4, 0x51435D53,
+    0x251D3B9E, 0x21DC2629, 0x2C9F00F0, 0x285E1D47, 0x36194D42, 0x32D850F5, 0x3F9B762C, 0x3B5A6B9B,
+    0x0315D626, 0x07D4CB91, 0x0A97ED48, 0x0E56F0FF, 0x1011A0FA, 0x14D0BD4D, 0x19939B94, 0x1D528623,
+    0xF12F560E, 0xF5EE4BB9, 0xF8AD6D60, 0xFC6C70D7, 0xE22B20D2, 0xE6EA3D65, 0xEBA91BBC, 0xEF68060B,
+    0xD727BBB6, 0xD3E6A601, 0xDEA580D8, 0xDA649D6F, 0xC423CD6A, 0xC0E2D0DD, 0xCDA1F604, 0xC960EBB3,
+    0xBD3E8D7E, 0xB9FF90C9, 0xB4BCB610, 0xB07DABA7, 0xAE3AFBA2, 0xAAFBE615, 0xA7B8C0CC, 0xA379DD7B,
+    0x9B3660C6, 0x9FF77D71, 0x92B45BA8, 0x9675461F, 0x8832161A, 0x8CF30BAD, 0x81B02D74, 0x857130C3,
+    0x5D8A9099, 0x594B8D2E, 0x5408ABF7, 0x50C9B640, 0x4E8EE645, 0x4A4FFBF2, 0x470CDD2B, 0x43CDC09C,
+    0x7B827D21, 0x7F436096, 0x7200464F, 0x76C15BF8, 0x68860BFD, 0x6C47164A, 0x61043093, 0x65C52D24,
+    0x119B4BE9, 0x155A565E, 0x18197087, 0x1CD86D30, 0x029F3D35, 0x065E2082, 0x0B1D065B, 0x0FDC1BEC,
+    0x3793A651, 0x3352BBE6, 0x3E119D3F, 0x3AD08088, 0x2497D08D, 0x2056CD3A, 0x2D15EBE3, 0x29D4F654,
+    0xC5A92679, 0xC1683BCE, 0xCC2B1D17, 0xC8EA00A0, 0xD6AD50A5, 0xD26C4D12, 0xDF2F6BCB, 0xDBEE767C,
+    0xE3A1CBC1, 0xE760D676, 0xEA23F0AF, 0xEEE2ED18, 0xF0A5BD1D, 0xF464A0AA, 0xF9278673, 0xFDE69BC4,
+    0x89B8FD09, 0x8D79E0BE, 0x803AC667, 0x84FBDBD0, 0x9ABC8BD5, 0x9E7D9662, 0x933EB0BB, 0x97FFAD0C,
+    0xAFB010B1, 0xAB710D06, 0xA6322BDF, 0xA2F33668, 0xBCB4666D, 0xB8757BDA, 0xB5365D03, 0xB1F740B4,
+};
+
+/** @brief a DMA run owns the CRC unit */
+static uint8_t dma_busy;
+
+#ifdef CRC_SOFTWARE
+/** @brief CRC of the streaming functions */
+static uint32_t sw_crc;
+/** @brief result of the last crc_dma_start() */
+static uint32_t dma_crc;
+#else
+/** @brief words of the DMA run after the current transfer */
+static const uint32_t *dma_next;
+static uint32_t dma_left;
+#endif
+
+/**
+ * @brief clock the CRC unit, before any other function here
+ */
+void crc_init(void) {
+#ifndef CRC_SOFTWARE
+    struct rcc_reg_map *rcc = RCC_BASE;
+    rcc->ahb1_enr |= CRC_CLKEN;
+    dma_init(CRC_DMA);
+#endif
+}
+
+/**
+ * @brief start a new CRC for crc_feed()
+ *
+ * @return 0 on success or -1 while a DMA run owns the CRC unit
+ */
+int crc_start(void) {
+    if (dma_busy) {
+        return -1;
+    }
+#ifdef CRC_SOFTWARE
+    sw_crc = CRC_INIT;
+#else
+    CRC_BASE->CR = CRC_CR_RESET;
+#endif
+    return 0;
+}
+
+/**
+ * @brief add words to the CRC begun by crc_start()
+ *
+ * @param words  data, each word most significant bit first
+ * @param count  number of words
+ */
+void crc_feed(const uint32_t *words, uint32_t count) {
+#ifdef CRC_SOFTWARE
+    sw_crc = crc_sw(sw_crc, words, count);
+#else
+    struct crc_reg_map *crc = CRC_BASE;
+    for (uint32_t i = 0; i < count; i++) {
+        crc->DR = words[i];
+    }
+#endif
+}
+
+/**
+ * @brief CRC of everything fed since crc_start()
+ */
+uint32_t crc_value(void) {
+#ifdef CRC_SOFTWARE
+    return sw_crc;
+#else
+    return CRC_BASE->DR;
+#endif
+}
+
+/**
+ * @brief CRC of a word buffer, on the CRC unit unless a DMA run has it
+ *
+ * @param words  data
+ * @param count  number of words
+ *
+ * @return the CRC
+ */
+uint32_t crc_words(const uint32_t *words, uint32_t count) {
+    if (crc_start() != 0) {
+        return crc_sw(CRC_INIT, words, count);
+    }
+    crc_feed(words, count);
+    return crc_value();
+}
+
+/**
+ * @brief CRC of a byte buffer, read as little endian words
+ *
+ * The last word is zero padded, so a buffer and the same buffer with up
+ * to 3 zero bytes appended have the same CRC. Any alignment.
+ *
+ * @param data  data
+ * @param len   bytes
+ *
+ * @return the CRC
+ */
+uint32_t crc_bytes(const void *data, uint32_t len) {
+    uint32_t buf[CRC_BYTES_CHUNK];
+    const uint8_t *p = data;
+    uint32_t crc = CRC_INIT;
+    int hw = (crc_start() == 0);
+
+    while (len > 0) {
+        uint32_t n = (len < sizeof(buf)) ? len : sizeof(buf);
+        uint32_t words = (n + 3) / 4;
+        buf[words - 1] = 0;
+        memcpy(buf, p, n);
+        if (hw) {
+            crc_feed(buf, words);
+        } else {
+            crc = crc_sw(crc, buf, words);
+        }
+        p += n;
+        len -= n;
+    }
+    return hw ? crc_value() : crc;
+}
+
+/**
+ * @brief continue a CRC in software, a byte of the register per lookup
+ *
+ * @param crc    CRC so far, CRC_INIT to start one
+ * @param words  data
+ * @param count  number of words
+ *
+ * @return the CRC including words
+ */
+uint32_t crc_sw(uint32_t crc, const uint32_t *words, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        crc ^= words[i];
+        crc = (crc << 8) ^ crc_table[crc >> 24];
+        crc = (crc << 8) ^ crc_table[crc >> 24];
+        crc = (crc << 8) ^ crc_table[crc >> 24];
+        crc = (crc << 8) ^ crc_table[crc >> 24];
+    }
+    return crc;
+}
+
+#ifndef CRC_SOFTWARE
+/**
+ * dma_transfer():
+ * @brief hand the next chunk of the run to the DMA
+ */
+static void dma_transfer(void) {
+    uint32_t n = (dma_left < CRC_DMA_CHUNK) ? dma_left : CRC_DMA_CHUNK;
+    const uint32_t *src = dma_next;
+    dma_next += n;
+    dma_left -= n;
+    dma_stream_start(CRC_DMA, CRC_DMA_STREAM,
+                     DMA_CR_DIR_M2M | DMA_CR_PINC | DMA_CR_PSIZE_32 | DMA_CR_MSIZE_32,
+                     (volatile void *)src, &CRC_BASE->DR, n);
+}
+#endif
+
+/**
+ * @brief start a CRC of a large buffer, fed to the CRC unit by the DMA
+ *
+ * The CPU is free until crc_dma_poll() reports the result; the buffer
+ * must not change before then. Flash or RAM, word aligned.
+ *
+ * @param words  data
+ * @param count  number of words, at least 1
+ *
+ * @return 0 on success or -1 when a run is already going
+ */
+int crc_dma_start(const uint32_t *words, uint32_t count) {
+    if (count == 0 || crc_start() != 0) {
+        return -1;
+    }
+#ifdef CRC_SOFTWARE
+    dma_crc = crc_sw(CRC_INIT, words, count);
+    dma_busy = 1;
+#else
+    dma_next = words;
+    dma_left = count;
+    dma_busy = 1;
+    dma_transfer();
+#endif
+    return 0;
+}
+
+/**
+ * @brief check on the run begun by crc_dma_start()
+ *
+ * @param crc  set to the CRC when the run is done
+ *
+ * @return 1 when done, 0 while running, -1 on a DMA error or with no run
+ */
+int crc_dma_poll(uint32_t *crc) {
+    if (!dma_busy) {
+        return -1;
+    }
+#ifdef CRC_SOFTWARE
+    *crc = dma_crc;
+#else
+    uint32_t flags = dma_flags(CRC_DMA, CRC_DMA_STREAM);
+    if (flags & (DMA_TEIF | DMA_DMEIF)) {
+        dma_stream_stop(CRC_DMA, CRC_DMA_STREAM);
+        dma_busy = 0;
+        return -1;
+    }
+    if (!(flags & DMA_TCIF)) {
+        return 0;
+    }
+    if (dma_left > 0) {
+        dma_transfer();
+        return 0;
+    }
+    *crc = CRC_BASE->DR;
+#endif
+    dma_busy = 0;
+    return 1;
+}
+
+/**
+ * @brief time the three paths over the first CRC_BENCH_BYTES of flash
+ *
+ * @param result  filled with the cycles of each path
+ */
+void crc_bench(crc_bench_t *result) {
+    const uint32_t *image = (const uint32_t *)CRC_BENCH_ADDR;
+    uint32_t words = CRC_BENCH_BYTES / 4;
+    uint32_t sw, hw, dma = 0;
+    uint32_t start;
+
+    dwt_init();
+    result->bytes = CRC_BENCH_BYTES;
+
+    start = dwt_cycles();
+    sw = crc_sw(CRC_INIT, image, words);
+    result->sw_cycles = dwt_cycles() - start;
+
+    start = dwt_cycles();
+    hw = crc_words(image, words);
+    result->hw_cycles = dwt_cycles() - start;
+
+    start = dwt_cycles();
+    int done = crc_dma_start(image, words);
+    while (done == 0) {
+        done = crc_dma_poll(&dma);
+    }
+    result->dma_cycles = dwt_cycles() - start;
+
+    result->match = (done == 1 && sw == hw && hw == dma);
+}
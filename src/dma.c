@@ -0,0 +1,124 @@
+/**
+ * @file dma.c
+ *
+ * @brief functions to set up DMA streams
+ *
+ * The per-stream status flags are spread over LISR/HISR at offsets 0, 6,
+ * 16 and 22; dma_flags() and dma_clear_flags() shift them down so callers
+ * only deal with the DMA_*IF bits.
+ *
+ * @date 03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <dma.h>
+#include <rcc.h>
+
+/** @brief the base address of each DMA controller */
+static struct dma_reg_map* const dma_base[] = {(void *)0x0,        // N/A
+                                               (void *)0x40026000, // DMA1
+                                               (void *)0x40026400};// DMA2
+
+/** @brief bit offset of each stream's flags within LISR/HISR */
+static const uint8_t flag_shift[] = {0, 6, 16, 22};
+
+/**
+ * @brief  Get the registers of a stream
+ *
+ * @param dma     - The controller, 1 or 2
+ * @param stream  - The stream, 0-7
+ *
+ * @return the stream registers or NULL when out of range
+ */
+struct dma_stream_reg_map *dma_stream(int dma, int stream) {
+  if (dma < 1 || dma > 2 || stream < 0 || stream > 7) return NULL;
+  return &dma_base[dma]->stream[stream];
+}
+
+/**
+ * @brief  Enable the clock of a DMA controller
+ *
+ * @param dma     - The controller, 1 or 2
+ */
+void dma_init(int dma) {
+  struct rcc_reg_map *rcc = RCC_BASE;
+  if (dma == 1) {
+    rcc->ahb1_enr |= DMA1_CLKEN;
+  } else if (dma == 2) {
+    rcc->ahb1_enr |= DMA2_CLKEN;
+  }
+}
+
+/**
+ * @brief  Stop a stream and wait until it has let go of the bus
+ *
+ * @param dma     - The controller, 1 or 2
+ * @param stream  - The stream, 0-7
+ */
+void dma_stream_stop(int dma, int stream) {
+  struct dma_stream_reg_map *s = dma_stream(dma, stream);
+  if (s == NULL) return;
+  s->cr &= ~DMA_CR_EN;
+  while (s->cr & DMA_CR_EN);
+}
+
+/**
+ * @brief  (Re)program and enable a stream, in direct mode for peripheral
+ *         transfers; memory to memory uses the FIFO, which it requires
+ *
+ * @param dma     - The controller, 1 or 2
+ * @param stream  - The stream, 0-7
+ * @param cr      - DMA_CR_* configuration without DMA_CR_EN
+ * @param periph  - peripheral data register
+ * @param mem     - memory buffer
+ * @param count   - number of data items
+ */
+void dma_stream_start(int dma, int stream, uint32_t cr, volatile void *periph,
+                      const volatile void *mem, uint16_t count) {
+  struct dma_stream_reg_map *s = dma_stream(dma, stream);
+  if (s == NULL) return;
+  dma_stream_stop(dma, stream);
+  dma_clear_flags(dma, stream, DMA_ALL_FLAGS);
+  s->par = (uint32_t)periph;
+  s->m0ar = (uint32_t)mem;
+  s->ndtr = count;
+  // direct mode, except memory to memory, which needs the FIFO
+  s->fcr = ((cr & DMA_CR_DIR_MASK) == DMA_CR_DIR_M2M) ? DMA_FCR_DMDIS | DMA_FCR_FTH_FULL : 0;
+  s->cr = cr;
+  s->cr = cr | DMA_CR_EN;
+}
+
+/**
+ * @brief  Read the status flags of a stream
+ *
+ * @param dma     - The controller, 1 or 2
+ * @param stream  - The stream, 0-7
+ *
+ * @return DMA_*IF bits
+ */
+uint32_t dma_flags(int dma, int stream) {
+  if (dma_stream(dma, stream) == NULL) return 0;
+  struct dma_reg_map *d = dma_base[dma];
+  uint32_t isr = (stream < 4) ? d->lisr : d->hisr;
+  return (isr >> flag_shift[stream & 3]) & DMA_ALL_FLAGS;
+}
+
+/**
+ * @brief  Clear status flags of a stream
+ *
+ * @param dma     - The controller, 1 or 2
+ * @param stream  - The stream, 0-7
+ * @param flags   - DMA_*IF bits to clear
+ */
+void dma_clear_flags(int dma, int stream, uint32_t flags) {
+  if (dma_stream(dma, stream) == NULL) return;
+  struct dma_reg_map *d = dma_base[dma];
+  uint32_t bits = (flags & DMA_ALL_FLAGS) << flag_shift[stream & 3];
+  if (stream < 4) {
+    d->lifcr = bits;
+  } else {
+    d->hifcr = bits;
+  }
+}
@@ -0,0 +1,127 @@
+/**
+ * @file flash.c
+ *
+ * @brief erase and program the on-chip flash, 32 bits at a time
+ *
+ * The code runs from the same flash bank, so the CPU (and any interrupt
+ * whose handler lives in flash) stalls while a write or an erase is in
+ * progress: ~16 us per word, 1-2 s for a 128 KB sector erase.
+ *
+ * @date 03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <flash.h>
+
+/** @brief The flash interface register map. */
+struct flash_reg_map {
+    volatile uint32_t ACR;      /**< 00 Access Control Register */
+    volatile uint32_t KEYR;     /**< 04 Key Register */
+    volatile uint32_t OPTKEYR;  /**< 08 Option Key Register */
+    volatile uint32_t SR;       /**< 0C Status Register */
+    volatile uint32_t CR;       /**< 10 Control Register */
+    volatile uint32_t OPTCR;    /**< 14 Option Control Register */
+};
+
+/** @brief Base address of the flash interface */
+#define FLASH_BASE  (struct flash_reg_map *) 0x40023C00
+
+/** @brief unlock sequence for CR */
+#define FLASH_KEY1  (0x45670123)
+#define FLASH_KEY2  (0xCDEF89AB)
+
+/** @brief SR: operation in progress */
+#define FLASH_SR_BSY    (1 << 16)
+/** @brief SR: every error flag (PGSERR, PGPERR, PGAERR, WRPERR, OPERR) */
+#define FLASH_SR_ERRORS ((1 << 7) | (1 << 6) | (1 << 5) | (1 << 4) | (1 << 1))
+/** @brief SR: end of operation */
+#define FLASH_SR_EOP    (1)
+
+/** @brief CR: program */
+#define FLASH_CR_PG     (1)
+/** @brief CR: sector erase */
+#define FLASH_CR_SER    (1 << 1)
+/** @brief CR: sector number field */
+#define FLASH_CR_SNB(n) ((n) << 3)
+/** @brief CR: 32-bit parallelism, valid for 2.7-3.6 V */
+#define FLASH_CR_PSIZE_X32 (2 << 8)
+/** @brief CR: start the erase */
+#define FLASH_CR_STRT   (1 << 16)
+/** @brief CR: locked */
+#define FLASH_CR_LOCK   (1u << 31)
+
+/** @brief largest sector number of the STM32F401RE */
+#define FLASH_LAST_SECTOR (7)
+
+/**
+ * flash_unlock():
+ * @brief open CR for writing and clear stale status
+ */
+static void flash_unlock(void) {
+    struct flash_reg_map *flash = FLASH_BASE;
+    if (flash->CR & FLASH_CR_LOCK) {
+        flash->KEYR = FLASH_KEY1;
+        flash->KEYR = FLASH_KEY2;
+    }
+    flash->SR = FLASH_SR_ERRORS | FLASH_SR_EOP;
+}
+
+/**
+ * flash_wait():
+ * @brief wait for the current operation and report its errors
+ *
+ * @return 0 on success or -1 on failure
+ */
+static int flash_wait(void) {
+    struct flash_reg_map *flash = FLASH_BASE;
+    while (flash->SR & FLASH_SR_BSY);
+    return (flash->SR & FLASH_SR_ERRORS) ? -1 : 0;
+}
+
+/**
+ * @brief erase one sector, leaving every byte 0xFF
+ *
+ * @param sector  sector number 0-7
+ *
+ * @return 0 on success or -1 on failure
+ */
+int flash_erase_sector(uint8_t sector) {
+    if (sector > FLASH_LAST_SECTOR) return -1;
+    struct flash_reg_map *flash = FLASH_BASE;
+
+    flash_unlock();
+    flash_wait();
+    flash->CR = FLASH_CR_PSIZE_X32 | FLASH_CR_SER | FLASH_CR_SNB(sector);
+    flash->CR |= FLASH_CR_STRT;
+    int status = flash_wait();
+    flash->CR = FLASH_CR_LOCK;
+    return status;
+}
+
+/**
+ * @brief program words into erased flash
+ *
+ * @param addr   word aligned flash address
+ * @param data   words to write
+ * @param words  number of words
+ *
+ * @return 0 on success or -1 on failure
+ */
+int flash_program(uint32_t addr, const uint32_t *data, uint32_t words) {
+    if (addr & 3) return -1;
+    struct flash_reg_map *flash = FLASH_BASE;
+    volatile uint32_t *dst = (volatile uint32_t *)addr;
+    int status = 0;
+
+    flash_unlock();
+    flash_wait();
+    flash->CR = FLASH_CR_PSIZE_X32 | FLASH_CR_PG;
+    for (uint32_t i = 0; i < words && status == 0; i++) {
+        dst[i] = data[i];
+        status = flash_wait();
+    }
+    flash->CR = FLASH_CR_LOCK;
+    return status;
+}
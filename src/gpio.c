@@ -78,6 +78,14 @@ void gpio_clr(gpio_port port, unsigned int num){
     gpio_regs[port]->bsrr = 1 << (num + 16);    /* Writing to bits 16-31 of BSRR clears the GPIO pin */
 }
 
+/*
+ * gpio_write_bsrr: Set and clear several pins of one port with a single
+ * write. Bits 0-15 of mask set the matching pins, bits 16-31 clear them.
+ */
+void gpio_write_bsrr(gpio_port port, uint32_t mask){
+    gpio_regs[port]->bsrr = mask;
+}
+
 /*
  * gpio_read: Read from selected GPIO pin.
  */
@@ -0,0 +1,131 @@
+/**
+ * @file   itm.c
+ *
+ * @brief  ITM stimulus port output on the SWO pin (PB3)
+ *
+ * itm_init() sets up the whole path the way a debugger would: trace
+ * enable in DEMCR, the SWO pin in DBGMCU, the TPIU for NRZ (UART style)
+ * output at the requested rate, and the ITM with the two ports in
+ * itm.h. A stimulus write is a store to the port once its FIFO has room;
+ * the TPIU drains it at the SWO rate whether or not a probe listens, so
+ * writers never stall for long.
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <itm.h>
+#include <dwt.h>
+#include <rcc.h>
+
+/** @brief stimulus port n, reads 1 when it can take a write */
+#define ITM_STIM(n) (*(volatile uint32_t *)(0xE0000000 + 4 * (n)))
+/** @brief stimulus port n as a byte, for one character packets */
+#define ITM_STIM8(n) (*(volatile uint8_t *)(0xE0000000 + 4 * (n)))
+/** @brief trace enable register, one bit per port */
+#define ITM_TER     (*(volatile uint32_t *) 0xE0000E00)
+/** @brief trace privilege register */
+#define ITM_TPR     (*(volatile uint32_t *) 0xE0000E40)
+/** @brief trace control register */
+#define ITM_TCR     (*(volatile uint32_t *) 0xE0000E80)
+/** @brief lock access register */
+#define ITM_LAR     (*(volatile uint32_t *) 0xE0000FB0)
+/** @brief key that unlocks the ITM registers */
+#define ITM_LAR_KEY (0xC5ACCE55)
+
+/** @brief TCR: enable the ITM */
+#define ITM_TCR_ITMENA  (1 << 0)
+/** @brief TCR: send synchronization packets */
+#define ITM_TCR_SYNCENA (1 << 2)
+/** @brief TCR: trace bus id, any nonzero value */
+#define ITM_TCR_BUSID   (1 << 16)
+
+/** @brief TPIU asynchronous clock prescaler */
+#define TPIU_ACPR   (*(volatile uint32_t *) 0xE0040010)
+/** @brief TPIU selected pin protocol */
+#define TPIU_SPPR   (*(volatile uint32_t *) 0xE00400F0)
+/** @brief TPIU formatter and flush control */
+#define TPIU_FFCR   (*(volatile uint32_t *) 0xE0040304)
+/** @brief SPPR: asynchronous NRZ */
+#define TPIU_SPPR_NRZ   (2)
+/** @brief FFCR: formatter off, only ITM/DWT packets reach the pin */
+#define TPIU_FFCR_PLAIN (0x100)
+
+/** @brief DWT_CTRL: synchronization packet tap on CYCCNT bit 24 */
+#define DWT_CTRL_SYNCTAP_24 (1 << 10)
+
+/** @brief debug MCU configuration register */
+#define DBGMCU_CR   (*(volatile uint32_t *) 0xE0042004)
+/** @brief DBGMCU_CR: trace pin enabled, asynchronous mode (SWO only) */
+#define DBGMCU_CR_TRACE_IOEN (1 << 5)
+/** @brief DBGMCU_CR: trace mode field */
+#define DBGMCU_CR_TRACE_MODE (3 << 6)
+
+/**
+ * @brief set up DWT, TPIU and ITM for SWO output
+ *
+ * @param swo_baud  SWO bit rate, a divisor of the core clock
+ */
+void itm_init(uint32_t swo_baud) {
+    dwt_init();
+    DBGMCU_CR = (DBGMCU_CR & ~DBGMCU_CR_TRACE_MODE) | DBGMCU_CR_TRACE_IOEN;
+
+    // the TPIU runs from the core clock
+    TPIU_SPPR = TPIU_SPPR_NRZ;
+    TPIU_ACPR = rcc_hclk_hz() / swo_baud - 1;
+    TPIU_FFCR = TPIU_FFCR_PLAIN;
+
+    ITM_LAR = ITM_LAR_KEY;
+    ITM_TCR = 0;
+    ITM_TPR = 0;
+    // a sync packet every 2^24 cycles lets the host find packet edges
+    DWT_CTRL |= DWT_CTRL_SYNCTAP_24;
+    ITM_TCR = ITM_TCR_BUSID | ITM_TCR_SYNCENA | ITM_TCR_ITMENA;
+    ITM_TER = (1 << ITM_PORT_PRINTK) | (1 << ITM_PORT_LOG);
+}
+
+/**
+ * @brief check that a port is on, writes to a port that is off are lost
+ *
+ * @return 1 when the port takes writes, 0 otherwise
+ */
+int itm_enabled(uint8_t port) {
+    return (ITM_TCR & ITM_TCR_ITMENA) && (ITM_TER & (1 << port));
+}
+
+/**
+ * @brief send text, one character per packet so itmdump -d shows it
+ */
+void itm_puts(uint8_t port, const char *ptr, size_t len) {
+    if (!itm_enabled(port)) {
+        return;
+    }
+    while (len--) {
+        while (ITM_STIM(port) == 0);
+        ITM_STIM8(port) = *ptr++;
+    }
+}
+
+/**
+ * @brief send a byte stream, four bytes per packet
+ *
+ * The last packet carries the one to three bytes left over, so the host
+ * gets the bytes back exactly.
+ */
+void itm_write(uint8_t port, const void *ptr, size_t len) {
+    const uint8_t *p = ptr;
+    if (!itm_enabled(port)) {
+        return;
+    }
+    for (; len >= 4; len -= 4, p += 4) {
+        uint32_t word = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+        while (ITM_STIM(port) == 0);
+        ITM_STIM(port) = word;
+    }
+    for (; len > 0; len--) {
+        while (ITM_STIM(port) == 0);
+        ITM_STIM8(port) = *p++;
+    }
+}
@@ -0,0 +1,138 @@
+/**
+ * @file   log.c
+ *
+ * @brief  binary log records for LOG() built with make LOG=bin, and the
+ *         rate limit of the LOG_*_RL() macros
+ *
+ * A record is assembled on the stack and queued on the console transmit
+ * ring in one write, which is also the log ring: the DMA drains records
+ * and printk() text in the order they were queued. Built with make
+ * LOG_OUT=itm, records go to ITM port ITM_PORT_LOG instead, a few cycles
+ * per word. Records from interrupt handlers go through the log queue
+ * (logq.c), or are sent to ITM with interrupts masked so that a record
+ * is never split by another.
+ *
+ * A rate limited call site owns a token bucket. Tokens are kept in
+ * thousandths, so refilling per_s tokens a second is a multiply by the
+ * milliseconds elapsed, no division.
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <stdarg.h>
+#include <log.h>
+#include <uart.h>
+#include <systick.h>
+#include <itm.h>
+#include <logq.h>
+#include <arm.h>
+
+/** @brief bytes of a record with no arguments */
+#define LOG_HEADER (7)
+
+/** @brief messages the rate limit dropped since boot */
+static volatile uint32_t suppressed;
+
+/**
+ * put32():
+ * @brief store a word little endian
+ */
+static uint8_t *put32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+/**
+ * @brief queue one record, called by LOG()
+ *
+ * Waits for ring space like printk(), a record is never cut short.
+ *
+ * @param id    offset of the format string in .logstr
+ * @param argc  number of 32 bit arguments that follow, at most LOG_ARGS_MAX
+ */
+void log_record(uint16_t id, int argc, ...) {
+    uint8_t rec[LOG_HEADER + 4 * LOG_ARGS_MAX];
+    uint8_t *p = rec;
+    va_list args;
+
+    if (argc > LOG_ARGS_MAX) {
+        argc = LOG_ARGS_MAX;
+    }
+    *p++ = LOG_SYNC | argc;
+    *p++ = id;
+    *p++ = id >> 8;
+    p = put32(p, systick_get_ticks());
+
+    va_start(args, argc);
+    for (int i = 0; i < argc; i++) {
+        p = put32(p, va_arg(args, uint32_t));
+    }
+    va_end(args);
+
+#ifdef LOG_ITM
+    uint32_t primask = irq_save();
+    itm_write(ITM_PORT_LOG, rec, p - rec);
+    irq_restore(primask);
+#else
+    if (in_handler()) {
+        logq_put(rec, p - rec);
+        return;
+    }
+    const char *ptr = (const char *)rec;
+    int len = p - rec;
+    while (len > 0) {
+        int sent = uart_write(STDOUT_FILENO, (char *)ptr, len);
+        if (sent < 0) {
+            return;
+        }
+        ptr += sent;
+        len -= sent;
+    }
+#endif
+}
+
+/**
+ * @brief take a token from a call site's bucket, called by LOG_*_RL()
+ *
+ * @param bucket  the call site's bucket
+ * @param per_s   tokens added per second
+ * @param burst   tokens the bucket holds
+ *
+ * @return 1 when the message may go out, 0 when it was dropped
+ */
+int log_allow(log_bucket_t *bucket, uint32_t per_s, uint32_t burst) {
+    uint32_t full = burst * 1000;
+    uint32_t primask = irq_save();
+    uint32_t now = systick_get_ticks();
+    uint32_t elapsed = now - bucket->last_ms;
+    int allow = 0;
+
+    bucket->last_ms = now;
+    // also keeps elapsed * per_s from overflowing after a long silence
+    if (elapsed >= full || bucket->milli_tokens + elapsed * per_s >= full) {
+        bucket->milli_tokens = full;
+    } else {
+        bucket->milli_tokens += elapsed * per_s;
+    }
+    if (bucket->milli_tokens >= 1000) {
+        bucket->milli_tokens -= 1000;
+        allow = 1;
+    } else {
+        suppressed++;
+    }
+    irq_restore(primask);
+    return allow;
+}
+
+/**
+ * @brief messages dropped by the rate limit since boot
+ */
+uint32_t log_suppressed(void) {
+    return suppressed;
+}
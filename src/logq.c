@@ -0,0 +1,130 @@
+/**
+ * @file   logq.c
+ *
+ * @brief  multi-producer log queue for interrupt handlers
+ *
+ * printk() and LOG() called from a handler cannot use the transmit ring:
+ * the thread writer may own its tail, and waiting for room would spin
+ * forever with the transmit interrupt blocked behind the caller. They put
+ * a message here instead.
+ *
+ * A producer claims the next slot by advancing claimed with LDREX/STREX,
+ * so handlers that preempt each other never share a slot. It fills the
+ * slot and commits it by setting ready after a barrier, then pends
+ * PendSV. When every slot is claimed the message is dropped and counted,
+ * a producer never waits.
+ *
+ * The console transmit path is the only consumer. It copies committed
+ * slots, in claim order and whole, into the transmit ring whenever no
+ * thread writer owns the tail: from PendSV, which runs after every other
+ * handler has returned, from the end of a thread write, and from the
+ * transmit DMA interrupt once there is room again.
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <logq.h>
+#include <uart.h>
+#include <nvic.h>
+#include <arm.h>
+
+/**
+ * LogSlot:
+ * @brief one message
+ */
+typedef struct {
+    /** @brief the producer finished writing, cleared by the consumer */
+    volatile uint8_t ready;
+    /** @brief bytes in data */
+    uint8_t len;
+    char data[LOGQ_DATA_MAX];
+} LogSlot;
+
+/** @brief the queue, slot n lives at n % LOGQ_SLOTS */
+static LogSlot slots[LOGQ_SLOTS];
+/** @brief slots claimed since boot, advanced by the producers */
+static volatile uint32_t claimed;
+/** @brief slots consumed since boot, advanced by the consumer */
+static volatile uint32_t consumed;
+/** @brief messages dropped because every slot was claimed */
+static volatile uint32_t dropped;
+
+/**
+ * @brief queue a message, from any context
+ *
+ * @param data  message bytes
+ * @param len   bytes, cut to LOGQ_DATA_MAX
+ *
+ * @return 0 on success or -1 when the queue was full and it was dropped
+ */
+int logq_put(const void *data, int len) {
+    uint32_t slot;
+
+    if (len > LOGQ_DATA_MAX) {
+        len = LOGQ_DATA_MAX;
+    }
+    do {
+        slot = ldrex(&claimed);
+        if (slot - consumed >= LOGQ_SLOTS) {
+            clrex();
+            atomic_add(&dropped, 1);
+            return -1;
+        }
+    } while (strex(slot + 1, &claimed));
+
+    LogSlot *s = &slots[slot & (LOGQ_SLOTS - 1)];
+    memcpy(s->data, data, len);
+    s->len = len;
+    dmb();
+    s->ready = 1;
+    nvic_pend_sv();
+    return 0;
+}
+
+/**
+ * @brief oldest committed message, for the single consumer
+ *
+ * A slot claimed but not yet committed holds back the ones after it, so
+ * messages come out in the order they were claimed.
+ *
+ * @param len  set to its length
+ *
+ * @return the message, or NULL when there is none
+ */
+const char *logq_peek(int *len) {
+    LogSlot *s = &slots[consumed & (LOGQ_SLOTS - 1)];
+    if (consumed == claimed || !s->ready) {
+        return NULL;
+    }
+    dmb();
+    *len = s->len;
+    return s->data;
+}
+
+/**
+ * @brief release the message returned by logq_peek()
+ */
+void logq_pop(void) {
+    slots[consumed & (LOGQ_SLOTS - 1)].ready = 0;
+    // the slot must read as free before a producer can claim it again
+    dmb();
+    consumed++;
+}
+
+/**
+ * @brief messages dropped since boot because the queue was full
+ */
+uint32_t logq_dropped(void) {
+    return dropped;
+}
+
+/**
+ * @brief PendSV, pended by logq_put(), hands the queue to the console
+ */
+void pend_sv_handler(void) {
+    uart_log_drain();
+}
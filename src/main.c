@@ -1,6 +1,16 @@
 #include <gpio.h>
 #include <i2c.h>
 #include <printk.h>
+#ifndef LOG_LEVEL_MAIN
+#define LOG_LEVEL_MAIN LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_MAIN
+#include <log.h>
+#include <itm.h>
+#include <logq.h>
+#include <proto.h>
+#include <crc.h>
+#include <shell.h>
 #include <uart_polling.h>
 #include <unistd.h>
 #include <lcd_driver.h>
@@ -10,7 +20,8 @@
 #include <uart.h>
 #include <timer.h>
 #include <servo.h>
-#include <stdlib.h>
+
+#define UNUSED __attribute__((unused))
 
 /**
  * key_display():
@@ -34,43 +45,319 @@ void key_display(char key, uint8_t *row, uint8_t *col) {
     (*col)++; // Move cursor position forward
 }
 
+/** @brief keypad moves: velocity limit in deg/s */
+#define MOVE_VEL (120)
+/** @brief keypad moves: acceleration limit in deg/s^2 */
+#define MOVE_ACC (360)
+/** @brief keypad moves: jerk limit in deg/s^3, 0 for trapezoidal */
+#define MOVE_JERK (1800)
+
 uint16_t enabled = 0;
 int active_channel = -1;
+int moving_channel = -1;
+uint32_t enabled_channels = 0;
+uint8_t streaming = 0;
+uint8_t binary_mode = 0;
 
 /**
- * process_minicom_command():
- * @brief to process the input command from minicom
-*/
-void process_minicom_command(char *command) {
-  int channel = -1;
-  // command: enable the servo
-  if (strncmp(command, "enable", 6) == 0) {
-    if (command[7] >= '0' && command[7] <= '9') {
-      channel = command[7] - '0' - 1;
-      servo_enable(channel, 1);
-      enabled = 1;
-      active_channel = channel;
-    } else {
-      printk("Invalid command\n");
-    }
-  } 
-  // command: disable the servo
-  else if (strncmp(command, "disable", 7) == 0) {
-    if (command[8] >= '0' && command[8] <= '9') {
-      channel = command[8] - '0' - 1;
-      servo_enable(channel, 0);
-      enabled = 0;
-      active_channel = -1;
-    } else {
-      printk("Invalid command\n");
-    }
-  } else {
+ * channel_arg():
+ * @brief convert a channel number as typed, from 1, to a channel index
+ *
+ * @return the index, or -1 after reporting an invalid channel
+*/
+int channel_arg(int32_t ch) {
+  if (ch < 1 || ch > SERVO_CHANNELS) {
+    printk("Invalid channel %d\n", (int)ch);
+    return -1;
+  }
+  return ch - 1;
+}
+
+/**
+ * cmd_enable():
+ * @brief enable <ch>: enable a servo and point the keypad at it
+*/
+int cmd_enable(UNUSED int argc, const shell_arg_t *argv) {
+  int ch = channel_arg(argv[0].i);
+  if (ch < 0 || servo_enable(ch, 1) != 0) {
+    return -1;
+  }
+  enabled_channels |= (1 << ch);
+  enabled = 1;
+  active_channel = ch;
+  return 0;
+}
+
+/**
+ * cmd_disable():
+ * @brief disable <ch>: disable a servo, the keypad too if it was on it
+*/
+int cmd_disable(UNUSED int argc, const shell_arg_t *argv) {
+  int ch = channel_arg(argv[0].i);
+  if (ch < 0 || servo_enable(ch, 0) != 0) {
+    return -1;
+  }
+  enabled_channels &= ~(1 << ch);
+  if (active_channel == ch) {
     enabled = 0;
     active_channel = -1;
-    printk("Invalid command\n");
   }
+  return 0;
+}
+
+/**
+ * cmd_set():
+ * @brief set <ch> <deg>: jump a servo to an angle
+*/
+int cmd_set(UNUSED int argc, const shell_arg_t *argv) {
+  int ch = channel_arg(argv[0].i);
+  if (ch < 0) {
+    return -1;
+  }
+  if (argv[1].i < 0 || argv[1].i > 180 || servo_set(ch, argv[1].i) != 0) {
+    printk("Invalid angle\n");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * cmd_move():
+ * @brief move <ch> <deg> [deg/s]: ramp an enabled servo to an angle
+*/
+int cmd_move(int argc, const shell_arg_t *argv) {
+  int ch = channel_arg(argv[0].i);
+  int32_t vel = (argc > 2) ? argv[2].i : MOVE_VEL;
+  if (ch < 0) {
+    return -1;
+  }
+  if (argv[1].i < 0 || argv[1].i > 180 || vel < 1 || vel > 0xFFFF) {
+    return SHELL_E_USAGE;
+  }
+  if (servo_move(ch, argv[1].i, vel, MOVE_ACC, MOVE_JERK) != 0) {
+    printk("Channel %d not enabled\n", ch + 1);
+    return -1;
+  }
+  moving_channel = ch;
+  return 0;
+}
+
+/**
+ * cmd_home():
+ * @brief home: move every enabled servo to 90 degrees, all arriving together
+*/
+int cmd_home(UNUSED int argc, UNUSED const shell_arg_t *argv) {
+  uint8_t channels[SERVO_CHANNELS];
+  uint8_t angles[SERVO_CHANNELS];
+  uint8_t count = 0;
+  for (int ch = 0; ch < SERVO_CHANNELS; ch++) {
+    if (enabled_channels & (1 << ch)) {
+      channels[count] = ch;
+      angles[count] = 90;
+      count++;
+    }
+  }
+  if (servo_move_group(count, channels, angles, MOVE_VEL, MOVE_ACC, MOVE_JERK) != 0) {
+    printk("No servo enabled\n");
+    return -1;
+  }
+  moving_channel = channels[0];
+  return 0;
+}
+
+/**
+ * cmd_stream():
+ * @brief stream [start [lead ms] | stop | stats]
+*/
+int cmd_stream(int argc, const shell_arg_t *argv) {
+  if (argc > 0 && strcmp(argv[0].s, "start") == 0) {
+    int32_t lead = (argc > 1) ? argv[1].i : 200;
+    servo_stream_start(lead < 0 ? 0 : lead);
+    streaming = 1;
+  } else if (argc == 1 && strcmp(argv[0].s, "stop") == 0) {
+    servo_stream_stop();
+    streaming = 0;
+  } else if (argc == 0 || (argc == 1 && strcmp(argv[0].s, "stats") == 0)) {
+    servo_stream_stats_t st;
+    servo_stream_stats(&st);
+    printk("stream: queued %u applied %u pending %u late %u underruns %u overruns %u\n",
+           st.queued, st.applied, st.pending, st.late, st.underruns, st.overruns);
+  } else {
+    return SHELL_E_USAGE;
+  }
+  return 0;
+}
+
+/**
+ * cmd_pt():
+ * @brief pt <ch> <0.1 deg> <ms>: queue a stream setpoint
+*/
+int cmd_pt(UNUSED int argc, const shell_arg_t *argv) {
+  int ch = channel_arg(argv[0].i);
+  if (ch < 0) {
+    return -1;
+  }
+  if (argv[1].i < 0 || argv[1].i > SERVO_DECIDEG_MAX ||
+      argv[2].i < 0 || argv[2].i > SERVO_STREAM_MS_MAX ||
+      servo_stream_push(ch, argv[1].i, argv[2].i) != 0) {
+    printk("Rejected setpoint\n");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * cmd_cal():
+ * @brief cal: print every channel, cal <ch> <min> <center> <max>: set and save
+*/
+int cmd_cal(int argc, const shell_arg_t *argv) {
+  if (argc == 0) {
+    servo_cal_t cal;
+    for (int ch = 0; ch < SERVO_CHANNELS; ch++) {
+      servo_cal_get(ch, &cal);
+      printk("ch %d: %u %u %u us\n", ch + 1, cal.min_us, cal.center_us, cal.max_us);
+    }
+    return 0;
+  }
+  if (argc != 4) {
+    return SHELL_E_USAGE;
+  }
+  int ch = channel_arg(argv[0].i);
+  if (ch < 0) {
+    return -1;
+  }
+  for (int i = 1; i < 4; i++) {
+    if (argv[i].i < 0 || argv[i].i > 0xFFFF) {
+      printk("Invalid calibration\n");
+      return -1;
+    }
+  }
+  // checked first, a calibration that cannot be saved is not applied
+  if (!servo_cal_can_save()) {
+    printk("Disable every servo before saving a calibration\n");
+    return -1;
+  }
+  servo_cal_t cal = { argv[1].i, argv[2].i, argv[3].i };
+  if (servo_cal_set(ch, &cal) != 0) {
+    printk("Invalid calibration\n");
+    return -1;
+  }
+  if (servo_cal_save() != 0) {
+    printk("Calibration applied but not saved\n");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * cmd_baud():
+ * @brief baud: show the console rate, baud <rate>: switch to it
+*/
+int cmd_baud(int argc, const shell_arg_t *argv) {
+  if (argc == 0) {
+    printk("baud %u\n", uart_get_baud());
+    return 0;
+  }
+  int32_t rate = argv[0].i;
+  if (rate <= 0) {
+    printk("Invalid baud rate\n");
+    return -1;
+  }
+  printk("Switching to %d baud\n", (int)rate);
+  uint32_t actual;
+  if (uart_set_baud(rate, &actual) != 0) {
+    printk("Baud rate out of range for the bus clock, or output stuck\n");
+    return -1;
+  }
+  // error in 0.01 %, the divider is >= 8 so |actual - rate| < rate / 16
+  // and the product stays in 32 bits
+  int32_t error = ((int32_t)actual - rate) * 10000 / rate;
+  int32_t mag = error < 0 ? -error : error;
+  printk("baud %u, error %s%d.%d%d%%\n", actual, error < 0 ? "-" : "",
+         mag / 100, (mag / 10) % 10, mag % 10);
+  return 0;
 }
 
+/**
+ * cmd_bench():
+ * @brief bench: time number formatting and the CRC paths
+*/
+int cmd_bench(UNUSED int argc, UNUSED const shell_arg_t *argv) {
+  printk_bench_t bench;
+  printk_bench(&bench);
+  printk("decimal: %u cycles dividing, %u cycles table, snprintk %u cycles\n",
+         bench.div_cycles, bench.fast_cycles, bench.snprintk_cycles);
+  crc_bench_t crc;
+  crc_bench(&crc);
+  printk("crc %u bytes: software %u, crc unit %u, dma %u cycles%s\n", crc.bytes,
+         crc.sw_cycles, crc.hw_cycles, crc.dma_cycles, crc.match ? "" : ", MISMATCH");
+  // no floating point, bytes per cycle scaled by 100
+  printk("crc bytes/cycle x100: software %u, crc unit %u, dma %u\n",
+         crc.bytes * 100 / crc.sw_cycles, crc.bytes * 100 / crc.hw_cycles,
+         crc.bytes * 100 / crc.dma_cycles);
+  return 0;
+}
+
+/**
+ * cmd_proto():
+ * @brief proto: hand the console to the binary protocol, see proto.h
+*/
+int cmd_proto(UNUSED int argc, UNUSED const shell_arg_t *argv) {
+  proto_start();
+  binary_mode = 1;
+  return 0;
+}
+
+/**
+ * cmd_stats():
+ * @brief stats: report the servo interrupt cost and console receive errors
+*/
+int cmd_stats(UNUSED int argc, UNUSED const shell_arg_t *argv) {
+  servo_isr_stats_t stats;
+  servo_isr_stats(&stats);
+  printk("servo isr: max %u, frame %u, worst frame %u cycles\n",
+         stats.last_isr_max, stats.last_frame_total, stats.worst_frame_total);
+  uart_stats_t rx;
+  uart_port_stats(UART_CONSOLE, &rx);
+  printk("uart rx: %u bytes, ring full %u, lines dropped %u\n",
+         rx.received, rx.ring_full, rx.lines_dropped);
+  printk("uart rx errors: overrun %u, framing %u, noise %u\n",
+         rx.overrun, rx.framing, rx.noise);
+  printk("log queue: %u dropped, rate limit %u suppressed\n",
+         logq_dropped(), log_suppressed());
+  proto_stats_t proto;
+  proto_stats(&proto);
+  printk("proto: %u requests, crc errors %u, framing errors %u\n",
+         proto.requests, proto.crc_errors, proto.framing_errors);
+  return 0;
+}
+
+/**
+ * cmd_help():
+ * @brief help: list the commands
+*/
+int cmd_help(UNUSED int argc, UNUSED const shell_arg_t *argv) {
+  shell_help();
+  return 0;
+}
+
+/** @brief console commands, sorted by name for the shell's binary search */
+static const shell_cmd_t commands[] = {
+  {"baud",    "I",    "[rate]",                  "Show or switch the console baud rate",     cmd_baud},
+  {"bench",   "",     "",                        "Time printk number formatting and CRCs",   cmd_bench},
+  {"cal",     "IIII", "[ch min center max]",     "Show or save pulse widths (us) at 0/90/180 deg", cmd_cal},
+  {"disable", "i",    "ch",                      "Disable servo channel",                    cmd_disable},
+  {"enable",  "i",    "ch",                      "Enable servo channel, the keypad sets it", cmd_enable},
+  {"help",    "",     "",                        "List the commands",                        cmd_help},
+  {"home",    "",     "",                        "Center all enabled servos together",       cmd_home},
+  {"move",    "iiI",  "ch deg [deg/s]",          "Ramp an enabled servo to an angle",        cmd_move},
+  {"proto",   "",     "",                        "Switch to binary packets, see proto.h",    cmd_proto},
+  {"pt",      "iii",  "ch 0.1deg ms",            "Queue a stream setpoint",                  cmd_pt},
+  {"set",     "ii",   "ch deg",                  "Jump a servo to an angle",                 cmd_set},
+  {"stats",   "",     "",                        "Servo interrupt timing and receive errors", cmd_stats},
+  {"stream",  "WI",   "[start [ms] | stop | stats]", "Timestamped setpoint streaming",       cmd_stream},
+};
+
 /**
  * process_keypad_input():
  * @brief to process the input number from keypad
@@ -84,15 +371,19 @@ void process_keypad_input(uint8_t *row, uint8_t *col) {
     if (key != '\0') {
       if (key == '#') {
         if (angle_idx > 0) {
-          printk("*User enters %s# to keypad*\n", angle_str);
           angle_str[angle_idx] = '\0';
-          int angle = atoi(angle_str);
+          int32_t angle = 0;
+          shell_parse_int(angle_str, &angle);
+          LOG_INFO("*User enters %d# to keypad*\n", angle);
           // Validate the angle (must be between 0 and 180 degrees)
           if (angle <= 180) {
-            servo_set(active_channel, angle); // Set the servo angle
-            printk("Setting channel %d to angle %d\n", active_channel + 1, angle);
+            // ramp the servo over instead of jumping, the timer interrupt
+            // runs the move
+            servo_move(active_channel, angle, MOVE_VEL, MOVE_ACC, MOVE_JERK);
+            moving_channel = active_channel;
+            LOG_INFO("Setting channel %d to angle %d\n", active_channel + 1, angle);
           } else {
-            printk("Invalid angle.\n");
+            LOG_WARN("Invalid angle.\n");
           }
           lcd_clear();
           *row = 0; // Reset cursor position for LCD
@@ -119,16 +410,23 @@ void process_keypad_input(uint8_t *row, uint8_t *col) {
 int main() {
   // initialize the uart and keypad
   systick_init();
+#if defined(PRINTK_ITM) || defined(LOG_ITM)
+  itm_init(SWO_BAUD);
+#endif
   uart_init(115200);
+#ifdef UART_FLOW
+  // PA0/PA1 become CTS/RTS, servo_enable() refuses servo channels 1 and 2
+  uart_port_flow_control(UART_CONSOLE, 1, 0);
+#endif
   keypad_init();
+  // before servo_init(), which checks the saved calibration
+  crc_init();
+  servo_init();
 
   // set GPIO
   // onboard LED (D13)
   gpio_init(GPIO_A, 5, MODE_GP_OUTPUT, OUTPUT_PUSH_PULL, OUTPUT_SPEED_LOW, PUPD_NONE, ALT0);
-  // SERVO 1 (A0)
-  gpio_init(GPIO_A, 0, MODE_GP_OUTPUT, OUTPUT_PUSH_PULL, OUTPUT_SPEED_LOW, PUPD_NONE, ALT0);
-  // SERVO 2 (A1)
-  gpio_init(GPIO_A, 1, MODE_GP_OUTPUT, OUTPUT_PUSH_PULL, OUTPUT_SPEED_LOW, PUPD_NONE, ALT0);
+  // SERVO 1 (A0) and SERVO 2 (A1) are switched to TIM2 by servo_enable()
 
   // initialize the i2c_master and lcd_driver
   timer_init(3, 16000, 3000); // allow the onboard led to blink every 3 seconds
@@ -138,27 +436,40 @@ int main() {
 
   uint8_t row = 0; //lcd cursor
   uint8_t col = 0; //lcd cursor
-  const uint32_t uart_interval = 10000;   // 10 seconds
-  uint32_t last_uart_time = systick_get_ticks() - uart_interval;
-  
 
-  printk("\nWelecome to Servo Controller!\nCommands\n  enable <ch>:  Enable servo channel\n");
-  printk("  disable <ch>: Disable servo channel\n  Set the servo angle using the keypad\n\n");
+  if (shell_init(commands, sizeof(commands) / sizeof(commands[0])) != 0) {
+    LOG_ERROR("Command table is not sorted\n");
+  }
+
+  LOG_INFO("\nWelecome to Servo Controller!\n");
+  LOG_INFO("  help lists the commands, ; separates several on one line\n");
+  LOG_INFO("  Set the servo angle using the keypad\n\n");
 
 
   char buffer[128];
+  printk("> ");
   while (1) {
-    uint32_t current_time = systick_get_ticks();
-    if ((current_time - last_uart_time) >= uart_interval) {
-      printk("> ");
-      if (uart_read(STDIN_FILENO, buffer, sizeof(buffer) - 1) > 0) {
-        process_minicom_command(buffer);
+    if (binary_mode) {
+      if (proto_poll()) {
+        binary_mode = 0;
+        printk("> ");
+      }
+    }
+    // lines are assembled by the uart interrupt, this never waits
+    else if (uart_readline_nb(buffer, sizeof(buffer)) > 0) {
+      shell_run(buffer);
+      // no prompt between the setpoint lines of a running stream or packets
+      if (!streaming && !binary_mode) {
+        printk("> ");
       }
-      last_uart_time = current_time;
     }
     if (enabled) {
       process_keypad_input(&row, &col);
     }
+    if (moving_channel >= 0 && servo_move_done(moving_channel)) {
+      LOG_INFO("Channel %d in position\n", moving_channel + 1);
+      moving_channel = -1;
+    }
   }
   return 0;
 }
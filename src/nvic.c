@@ -43,4 +43,21 @@ void nvic_clear_pending( uint8_t irq_num ) {
   struct nvic_t *nvic = NVIC_ICPR_BASE;
 
   nvic->reg[reg_num] |= ( 0x1 << shift_num );
-}
\ No newline at end of file
+}
+
+/*
+ * nvic_pend_sv_init():
+ * @brief give PendSV the lowest priority, so it only runs once every
+ * other interrupt has returned
+*/
+void nvic_pend_sv_init( void ) {
+  SCB_SHPR3 |= PEND_SV_PRIORITY;
+}
+
+/*
+ * nvic_pend_sv():
+ * @brief request PendSV, safe from any context
+*/
+void nvic_pend_sv( void ) {
+  SCB_ICSR = ICSR_PENDSVSET;
+}
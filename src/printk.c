@@ -3,6 +3,28 @@
  *
  * @brief      printk() implementation using UART
  *
+ * Formatting goes through one routine that writes into a buffer.
+ * vsnprintk() and snprintk() give the caller's buffer to it. printk()
+ * gives it a small buffer on the stack and hands every full buffer, and
+ * the rest at the end, to the UART in one bulk enqueue. A typical message
+ * costs a single uart_write() instead of one call per character. Built
+ * with make PRINTK_OUT=itm, the text goes to ITM port ITM_PORT_PRINTK
+ * instead and leaves the console to the command line.
+ *
+ * Called from an interrupt handler, printk() must not wait for the
+ * transmit ring, so the message, cut to LOGQ_DATA_MAX, goes through the
+ * log queue (logq.c) and is dropped if that is full.
+ *
+ * Numbers are converted without division: decimal takes two digits at a
+ * time from a table, dividing by 100 with a reciprocal multiply, and 64
+ * bit values are first split into 32 bit parts by 10000 the same way. Hex
+ * and octal are shifts. printk_bench() compares this with the old digit
+ * by digit loop.
+ *
+ * Conversions: %d %u %o %x %p %s %c %%, with an optional '0' or '-' flag,
+ * a field width and the l (long, 32 bit here) or ll (64 bit) size on
+ * d, u, o and x.
+ *
  * @date       July 27 2015
  * @author     Aaron Reyes <areyes@andrew.cmu.edu>
  */
@@ -10,145 +32,357 @@
 #include <unistd.h>
 #include <stdarg.h>
 #include <uart.h>
-#include <uart_polling.h>
+#include <dwt.h>
+#include <itm.h>
+#include <logq.h>
+#include <arm.h>
+#include <printk.h>
 
 
 /**
- * allows for numbers with 64 digits/letters
+ * digits of the longest number, a 64 bit value in octal has 22
  */
-#define MAXBUF ( sizeof( uint32_t ) )
+#define MAXBUF ( 24 )
+
+/**
+ * printk() formats this many characters on the stack between enqueues
+ */
+#define PRINTK_BUF ( 128 )
+
+/**
+ * numbers converted by each half of printk_bench()
+ */
+#define BENCH_NUMBERS ( 256 )
 
 /**
  * static array of digits for use in printnum(s)
  */
-static char digits[] = "0123456789abcdef";
+static const char digits[] = "0123456789abcdef";
+
+/**
+ * "00" to "99", two decimal digits per lookup
+ */
+static const char digit_pairs[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+/**
+ * @brief      destination of the formatter
+ */
+typedef struct {
+  /** @brief output characters */
+  char *buf;
+  /** @brief size of buf */
+  size_t size;
+  /** @brief characters in buf */
+  size_t len;
+  /** @brief characters produced in total, including any that did not fit */
+  size_t total;
+  /** @brief send buf to the console whenever it fills instead of truncating */
+  int console;
+} printk_out;
+
+/**
+ * @brief      queue bytes on the console, waiting for room if the ring is full
+ */
+static void uart_wrapper( const char *ptr, size_t len ) {
+#ifdef PRINTK_ITM
+  itm_puts( ITM_PORT_PRINTK, ptr, len );
+#else
+  while ( len > 0 ) {
+    int sent = uart_write( STDOUT_FILENO, ( char * )ptr, len );
+    if ( sent < 0 ) {
+      return;
+    }
+    ptr += sent;
+    len -= sent;
+  }
+#endif
+}
+
+/**
+ * @brief      append a character to the output
+ */
+static void putk( printk_out *out, char c ) {
+  out->total++;
+  if ( out->console ) {
+    if ( out->len == out->size ) {
+      uart_wrapper( out->buf, out->len );
+      out->len = 0;
+    }
+    out->buf[out->len++] = c;
+  }
+  // the last byte is kept for the terminator
+  else if ( out->len + 1 < out->size ) {
+    out->buf[out->len++] = c;
+  }
+}
 
-void uart_wrapper ( char c ) {
-  // uart_polling_put_byte( c );
-  while ( uart_put_byte( c ));
+/**
+ * @brief      num / 100 for any 32 bit num
+ */
+static inline uint32_t div100( uint32_t num ) {
+  return ( ( uint64_t )num * 0x51EB851F ) >> 37;
+}
+
+/**
+ * @brief      num / 10000 for any 32 bit num
+ */
+static inline uint32_t div10000( uint32_t num ) {
+  return ( ( uint64_t )num * 0xD1B71759 ) >> 45;
+}
+
+/**
+ * @brief      write num in decimal, ending just before end
+ *
+ * @return     the first digit
+ */
+static char *utoa10( char *end, uint32_t num ) {
+  while ( num >= 100 ) {
+    uint32_t q = div100( num );
+    const char *pair = &digit_pairs[2 * ( num - q * 100 )];
+    *--end = pair[1];
+    *--end = pair[0];
+    num = q;
+  }
+
+  if ( num >= 10 ) {
+    *--end = digit_pairs[2 * num + 1];
+    *--end = digit_pairs[2 * num];
+  }
+  else {
+    *--end = digits[num];
+  }
+  return end;
+}
+
+/**
+ * @brief      write a 64 bit num in decimal, ending just before end
+ *
+ * Divides by 10000 in 16 bit steps until the rest fits in 32 bits; every
+ * remainder is four digits.
+ *
+ * @return     the first digit
+ */
+static char *u64toa10( char *end, uint64_t num ) {
+  while ( num >> 32 ) {
+    uint32_t part[4] = {
+      num >> 48, ( num >> 32 ) & 0xFFFF, ( num >> 16 ) & 0xFFFF, num & 0xFFFF
+    };
+    uint32_t rem = 0;
+
+    // rem < 10000, so ( rem << 16 ) | part still fits in 32 bits
+    for ( int i = 0; i < 4; i++ ) {
+      uint32_t cur = ( rem << 16 ) | part[i];
+      part[i] = div10000( cur );
+      rem = cur - part[i] * 10000;
+    }
+    num = ( ( uint64_t )part[0] << 48 ) | ( ( uint64_t )part[1] << 32 ) |
+          ( part[2] << 16 ) | part[3];
+
+    uint32_t hi = div100( rem );
+    uint32_t lo = rem - hi * 100;
+    *--end = digit_pairs[2 * lo + 1];
+    *--end = digit_pairs[2 * lo];
+    *--end = digit_pairs[2 * hi + 1];
+    *--end = digit_pairs[2 * hi];
+  }
+  return utoa10( end, num );
+}
+
+/**
+ * @brief      write num in base 8 or 16, ending just before end
+ *
+ * @return     the first digit
+ */
+static char *u64toa_pow2( char *end, uint64_t num, uint8_t shift ) {
+  uint32_t mask = ( 1 << shift ) - 1;
+
+  do {
+    *--end = digits[num & mask];
+    num >>= shift;
+  }
+  while ( num != 0 );
+  return end;
 }
 
 /**
  * @brief      prints a number
  *
- * @param      base  8, 10, 16
- * @param      num   the number to print
+ * @param      out    the output
+ * @param      base   8, 10, 16
+ * @param      num    the magnitude to print
+ * @param      neg    print a minus sign first
+ * @param      width  minimum field width, including sign and prefix
+ * @param      flag   '0' to pad with zeros, '-' to pad on the right
  */
-static void printnumk( uint8_t base, uint32_t num ) {
-  int8_t *prefix = 0;
-  int8_t buf[MAXBUF];
-  int8_t *ptr = &buf[MAXBUF - 1];
+static void printnumk( printk_out *out, uint8_t base, uint64_t num, int neg,
+                       int width, char flag ) {
+  const char *prefix = "";
+  char buf[MAXBUF];
+  char *end = &buf[MAXBUF];
+  char *ptr;
 
   // standard radius prefixes
-  if ( base == 8 ) {
-    prefix = ( int8_t * )"0";
+  if ( neg ) {
+    prefix = "-";
+  }
+  else if ( base == 8 ) {
+    prefix = "0";
   }
   else if ( base == 16 ) {
-    prefix = ( int8_t * )"0x";
+    prefix = "0x";
   }
 
   // convert number to string in buffer
-  do {
-    *ptr-- = digits[num % base];
-    num /= base;
+  if ( base == 10 ) {
+    ptr = ( num >> 32 ) ? u64toa10( end, num ) : utoa10( end, num );
+  }
+  else {
+    ptr = u64toa_pow2( end, num, ( base == 16 ) ? 4 : 3 );
+  }
+
+  int pad = width - ( end - ptr );
+  for ( const char *p = prefix; *p; p++ ) {
+    pad--;
   }
-  while ( num != 0 );
 
   // print result
-  if ( prefix ) {
-    while ( *prefix ) {
-      uart_wrapper( *prefix++ );
+  if ( flag != '0' && flag != '-' ) {
+    for ( ; pad > 0; pad-- ) {
+      putk( out, ' ' );
+    }
+  }
+
+  while ( *prefix ) {
+    putk( out, *prefix++ );
+  }
+
+  if ( flag == '0' ) {
+    for ( ; pad > 0; pad-- ) {
+      putk( out, '0' );
     }
   }
 
-  while ( ++ptr != &buf[MAXBUF] ) {
-    uart_wrapper( *ptr );
+  while ( ptr != end ) {
+    putk( out, *ptr++ );
+  }
+
+  for ( ; pad > 0; pad-- ) {
+    putk( out, ' ' );
   }
 }
 
 /**
- * @brief      A kernel printf() function for debugging the kernel
- *
- * @param      fmt        the format string
- * @param[in]  <unnamed>  variadic input
- *
- * @return     0 on success or -1 on failure
+ * @brief      print a string padded to width
  */
-int printk( const char *fmt, ... ) {
-  va_list args;
-  // set up va_list and print it
-  va_start( args, fmt );
+static void printstrk( printk_out *out, const char *str, size_t len,
+                       int width, char flag ) {
+  int pad = width - ( int )len;
 
+  if ( flag != '-' ) {
+    for ( ; pad > 0; pad-- ) {
+      putk( out, ' ' );
+    }
+  }
+
+  while ( len-- ) {
+    putk( out, *str++ );
+  }
+
+  for ( ; pad > 0; pad-- ) {
+    putk( out, ' ' );
+  }
+}
+
+/**
+ * @brief      format into out
+ *
+ * @return     characters produced or -1 on an unknown conversion
+ */
+static int formatk( printk_out *out, const char *fmt, va_list args ) {
   // loop through format string looking for formatting
   while ( *fmt ) {
     // handle normal characters
     if ( *fmt != '%' ) {
-      uart_wrapper( *fmt++ );
+      putk( out, *fmt++ );
       continue;
     }
 
     fmt++;
 
-    // handle formatting
-    switch ( *fmt ) {
-
-    case 'd': { // signed decimal
-      int32_t num = va_arg( args, int32_t );
+    // flags, width and size
+    char flag = 0;
+    int width = 0;
+    int longs = 0;
 
-      if ( num < 0 ) {
-        uart_wrapper( '-' );
-        printnumk( 10, -num );
-      }
-      else {
-        printnumk( 10, num );
+    while ( *fmt == '0' || *fmt == '-' ) {
+      // '-' wins over '0' like in printf()
+      if ( flag != '-' ) {
+        flag = *fmt;
       }
+      fmt++;
+    }
 
-      break;
+    while ( *fmt >= '0' && *fmt <= '9' ) {
+      width = width * 10 + ( *fmt++ - '0' );
     }
 
-    case 'u': { // unsigned decimal
-      uint32_t num = va_arg( args, uint32_t );
-      printnumk( 10, num );
+    while ( *fmt == 'l' && longs < 2 ) {
+      longs++;
+      fmt++;
+    }
+
+    // handle formatting
+    switch ( *fmt ) {
+
+    case 'd': { // signed decimal
+      int64_t num = ( longs == 2 ) ? va_arg( args, int64_t ) : va_arg( args, int32_t );
+      uint64_t mag = ( num < 0 ) ? -( uint64_t )num : ( uint64_t )num;
+      printnumk( out, 10, mag, num < 0, width, flag );
       break;
     }
 
-    case 'o': { // octal
-      uint32_t num = va_arg( args, uint32_t );
-      printnumk( 8, num );
+    case 'u': // unsigned decimal
+    case 'o': // octal
+    case 'x': { // hex
+      uint64_t num = ( longs == 2 ) ? va_arg( args, uint64_t ) : va_arg( args, uint32_t );
+      uint8_t base = ( *fmt == 'u' ) ? 10 : ( *fmt == 'o' ) ? 8 : 16;
+      printnumk( out, base, num, 0, width, flag );
       break;
     }
 
-    case 'x': // hex
     case 'p': { // pointer
       uint32_t num = va_arg( args, uint32_t );
-      printnumk( 16, num );
+      printnumk( out, 16, num, 0, width, flag );
       break;
     }
 
     case 's': { // string
-      int8_t *byte_ptr = ( int8_t * )va_arg( args, int32_t );
+      const char *byte_ptr = va_arg( args, const char * );
+      size_t len = 0;
 
-      while ( *byte_ptr ) {
-        uart_wrapper( *byte_ptr );
-        byte_ptr++;
+      while ( byte_ptr[len] ) {
+        len++;
       }
 
+      printstrk( out, byte_ptr, len, width, flag );
       break;
     }
 
     case 'c': { // character
-      int32_t byte = va_arg( args, int32_t );
-      uart_wrapper( byte );
+      char byte = va_arg( args, int32_t );
+      printstrk( out, &byte, 1, width, flag );
       break;
     }
 
     case '%': { // escaped percent symbol
-      uart_wrapper( '%' );
+      putk( out, '%' );
       break;
     }
 
     default: { // error
-      va_end( args );
       return -1;
     }
     }
@@ -156,6 +390,122 @@ int printk( const char *fmt, ... ) {
     fmt++;
   }
 
+  return out->total;
+}
+
+/**
+ * @brief      printk() into a buffer
+ *
+ * @param      buf   destination, always terminated unless size is 0
+ * @param      size  size of buf
+ * @param      fmt   the format string
+ * @param      args  the arguments
+ *
+ * @return     length of the whole output, which is size or more when it was
+ *             truncated, or -1 on failure
+ */
+int vsnprintk( char *buf, size_t size, const char *fmt, va_list args ) {
+  printk_out out = { buf, size, 0, 0, 0 };
+  int len = formatk( &out, fmt, args );
+
+  if ( size > 0 ) {
+    buf[out.len] = '\0';
+  }
+  return len;
+}
+
+/**
+ * @brief      snprintf() for the kernel, see vsnprintk()
+ */
+int snprintk( char *buf, size_t size, const char *fmt, ... ) {
+  va_list args;
+  va_start( args, fmt );
+  int len = vsnprintk( buf, size, fmt, args );
+  va_end( args );
+  return len;
+}
+
+/**
+ * @brief      A kernel printf() function for debugging the kernel
+ *
+ * @param      fmt        the format string
+ * @param[in]  <unnamed>  variadic input
+ *
+ * @return     0 on success or -1 on failure
+ */
+int printk( const char *fmt, ... ) {
+  char buf[PRINTK_BUF];
+#ifdef PRINTK_ITM
+  // stimulus writes are safe from any context
+  int queued = 0;
+#else
+  int queued = in_handler();
+#endif
+  // a queued message is cut to one slot instead of flushed in parts
+  printk_out out = { buf, queued ? LOGQ_DATA_MAX + 1 : sizeof( buf ), 0, 0, !queued };
+  va_list args;
+  // set up va_list and print it
+  va_start( args, fmt );
+  int len = formatk( &out, fmt, args );
   va_end( args );
-  return 0;
+
+  // what was formatted before an error still goes out
+  if ( queued ) {
+    return ( logq_put( buf, out.len ) < 0 || len < 0 ) ? -1 : 0;
+  }
+  uart_wrapper( buf, out.len );
+  return ( len < 0 ) ? -1 : 0;
+}
+
+/**
+ * @brief      the digit at a time conversion printk() used to do, kept as
+ *             the baseline of printk_bench()
+ */
+static char *utoa_div( char *end, uint32_t num, uint8_t base ) {
+  do {
+    *--end = digits[num % base];
+    num /= base;
+  }
+  while ( num != 0 );
+  return end;
+}
+
+/**
+ * @brief      measure decimal conversion, old and new, on the same numbers
+ *
+ * The numbers run through every length from 1 to 10 digits.
+ *
+ * @param      result  filled with the average cycles per number
+ */
+void printk_bench( printk_bench_t *result ) {
+  // volatile so neither loop is optimized away or told the base is 10
+  volatile uint8_t base = 10;
+  volatile char sink;
+  char buf[MAXBUF];
+  uint32_t seed = 12345;
+  uint32_t start;
+
+  dwt_init();
+
+  start = dwt_cycles();
+  for ( int i = 0; i < BENCH_NUMBERS; i++ ) {
+    seed = seed * 1664525 + 1013904223;
+    sink = *utoa_div( &buf[MAXBUF], seed >> ( i & 31 ), base );
+  }
+  result->div_cycles = ( dwt_cycles() - start ) / BENCH_NUMBERS;
+
+  seed = 12345;
+  start = dwt_cycles();
+  for ( int i = 0; i < BENCH_NUMBERS; i++ ) {
+    seed = seed * 1664525 + 1013904223;
+    sink = *utoa10( &buf[MAXBUF], seed >> ( i & 31 ) );
+  }
+  result->fast_cycles = ( dwt_cycles() - start ) / BENCH_NUMBERS;
+
+  start = dwt_cycles();
+  for ( int i = 0; i < BENCH_NUMBERS; i++ ) {
+    snprintk( buf, sizeof( buf ), "%08lu", seed >> ( i & 31 ) );
+  }
+  result->snprintk_cycles = ( dwt_cycles() - start ) / BENCH_NUMBERS;
+  ( void )sink;
 }
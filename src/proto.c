@@ -0,0 +1,305 @@
+/**
+ * @file   proto.c
+ *
+ * @brief  binary servo command protocol, see proto.h
+ *
+ * The text command proto hands the console to this module: line mode is
+ * turned off so the receive interrupt leaves the bytes in the ring, and
+ * the main loop calls proto_poll() instead of reading lines. Bytes that
+ * arrived before the switch went to the line editor, so a host waits for
+ * the reply to a PROTO_OP_PING before it sends anything else.
+ *
+ * Encoded bytes collect in rx_buf until a 0x00 ends the packet, which is
+ * then decoded in place, checked and answered. Replies are written like
+ * printk() text, so log messages can still reach the console between
+ * packets; the 0x00 sent before every reply keeps such text out of it,
+ * and the host drops whatever fails the CRC.
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <proto.h>
+#include <servo.h>
+#include <uart.h>
+#include <crc.h>
+
+/** @brief bytes of the sequence number, opcode and CRC around a payload */
+#define PROTO_OVERHEAD (6)
+/** @brief longest encoded packet, COBS adds a byte per 254 */
+#define PROTO_ENCODED_MAX (PROTO_PACKET_MAX + 2)
+
+/** @brief encoded bytes of the packet being received */
+static uint8_t rx_buf[PROTO_ENCODED_MAX];
+/** @brief bytes in rx_buf */
+static uint8_t rx_len;
+/** @brief the packet outgrew rx_buf, skip to the next 0x00 */
+static uint8_t rx_overflow;
+/** @brief counters for PROTO_OP_STATS and the stats command */
+static proto_stats_t stats;
+
+/**
+ * cobs_decode():
+ * @brief undo COBS in place, the output is never longer than the input
+ *
+ * @return decoded length, or -1 for an invalid encoding
+ */
+static int cobs_decode(uint8_t *buf, int len) {
+    int in = 0;
+    int out = 0;
+    while (in < len) {
+        uint8_t code = buf[in++];
+        if (code == 0 || in + code - 1 > len) {
+            return -1;
+        }
+        for (int i = 1; i < code; i++) {
+            buf[out++] = buf[in++];
+        }
+        if (code != 0xFF && in < len) {
+            buf[out++] = 0;
+        }
+    }
+    return out;
+}
+
+/**
+ * cobs_encode():
+ * @brief COBS encode len bytes, dst needs len + len / 254 + 1 bytes
+ *
+ * @return encoded length
+ */
+static int cobs_encode(const uint8_t *src, int len, uint8_t *dst) {
+    int code_at = 0;
+    int out = 1;
+    uint8_t code = 1;
+    for (int i = 0; i < len; i++) {
+        if (src[i] == 0) {
+            dst[code_at] = code;
+            code_at = out++;
+            code = 1;
+            continue;
+        }
+        dst[out++] = src[i];
+        if (++code == 0xFF) {
+            dst[code_at] = code;
+            code_at = out++;
+            code = 1;
+        }
+    }
+    dst[code_at] = code;
+    return out;
+}
+
+/**
+ * get16():
+ * @brief load a little endian halfword
+ */
+static uint16_t get16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+/**
+ * get32():
+ * @brief load a little endian word
+ */
+static uint32_t get32(const uint8_t *p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+/**
+ * put32():
+ * @brief store a word little endian
+ */
+static uint8_t *put32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+/**
+ * frame_crc():
+ * @brief CRC of a packet, its length mixed in as one more word
+ *
+ * crc_bytes() zero pads the last word, so without the length a packet
+ * that gained or lost zero bytes at the end would still pass.
+ *
+ * @param pkt  packet without its CRC
+ * @param len  bytes
+ */
+static uint32_t frame_crc(const uint8_t *pkt, int len) {
+    uint32_t n = len;
+    return crc_sw(crc_bytes(pkt, len), &n, 1);
+}
+
+/**
+ * reply():
+ * @brief frame and queue a reply, waiting for transmit ring space
+ *
+ * @param pkt  reply with room for the CRC after len bytes
+ * @param len  bytes from the sequence number to the end of the payload
+ */
+static void reply(uint8_t *pkt, int len) {
+    uint8_t frame[PROTO_ENCODED_MAX + 2];
+    put32(pkt + len, frame_crc(pkt, len));
+    frame[0] = 0;
+    int n = 1 + cobs_encode(pkt, len + 4, frame + 1);
+    frame[n++] = 0;
+
+    const char *ptr = (const char *)frame;
+    while (n > 0) {
+        int sent = uart_write(STDOUT_FILENO, (char *)ptr, n);
+        if (sent < 0) {
+            return;
+        }
+        ptr += sent;
+        n -= sent;
+    }
+}
+
+/**
+ * execute():
+ * @brief carry out one request
+ *
+ * @param op    opcode
+ * @param arg   payload
+ * @param len   payload bytes
+ * @param out   reply payload, room for PROTO_PACKET_MAX - PROTO_OVERHEAD - 1 bytes
+ * @param olen  set to the reply payload bytes
+ *
+ * @return PROTO_* status
+ */
+static int execute(uint8_t op, const uint8_t *arg, int len, uint8_t *out, int *olen) {
+    static const int8_t arg_len[] = {
+        [PROTO_OP_PING] = 0, [PROTO_OP_ENABLE] = 1, [PROTO_OP_DISABLE] = 1,
+        [PROTO_OP_SET] = 3, [PROTO_OP_MOVE] = 8, [PROTO_OP_QUERY] = 1,
+        [PROTO_OP_STATS] = 0,
+    };
+    int status = 0;
+
+    *olen = 0;
+    if (op == PROTO_OP_TEXT) {
+        return len == 0 ? PROTO_OK : PROTO_E_LENGTH;
+    }
+    if (op >= sizeof(arg_len)) {
+        return PROTO_E_OPCODE;
+    }
+    if (len != arg_len[op]) {
+        return PROTO_E_LENGTH;
+    }
+    // checked here, the driver would also log the bad channel
+    if (len > 0 && arg[0] >= SERVO_CHANNELS) {
+        return PROTO_E_REJECTED;
+    }
+
+    switch (op) {
+    case PROTO_OP_ENABLE:
+    case PROTO_OP_DISABLE:
+        status = servo_enable(arg[0], op == PROTO_OP_ENABLE);
+        break;
+    case PROTO_OP_SET:
+        status = servo_set_decideg(arg[0], get16(arg + 1));
+        break;
+    case PROTO_OP_MOVE:
+        status = servo_move(arg[0], arg[1], get16(arg + 2), get16(arg + 4), get16(arg + 6));
+        break;
+    case PROTO_OP_QUERY: {
+        servo_state_t state;
+        status = servo_get_state(arg[0], &state);
+        out[0] = state.enabled;
+        out[1] = state.moving;
+        out[2] = state.decideg;
+        out[3] = state.decideg >> 8;
+        *olen = 4;
+        break;
+    }
+    case PROTO_OP_STATS:
+        put32(put32(put32(out, stats.requests), stats.crc_errors), stats.framing_errors);
+        *olen = 12;
+        break;
+    default:
+        break;
+    }
+    return status == 0 ? PROTO_OK : PROTO_E_REJECTED;
+}
+
+/**
+ * packet():
+ * @brief check and answer the packet in rx_buf
+ *
+ * @return 1 when it was PROTO_OP_TEXT, 0 otherwise
+ */
+static int packet(void) {
+    uint8_t resp[PROTO_PACKET_MAX];
+    int len = cobs_decode(rx_buf, rx_len);
+    if (len < PROTO_OVERHEAD) {
+        stats.framing_errors++;
+        return 0;
+    }
+    len -= 4;
+    if (frame_crc(rx_buf, len) != get32(rx_buf + len)) {
+        stats.crc_errors++;
+        return 0;
+    }
+
+    int olen;
+    uint8_t op = rx_buf[1];
+    resp[0] = rx_buf[0];
+    resp[1] = op | PROTO_REPLY;
+    resp[2] = execute(op, rx_buf + 2, len - 2, resp + 3, &olen);
+    stats.requests++;
+    reply(resp, 3 + olen);
+    return op == PROTO_OP_TEXT && resp[2] == PROTO_OK;
+}
+
+/**
+ * @brief take the console over for packets, called by the proto command
+ */
+void proto_start(void) {
+    rx_len = 0;
+    rx_overflow = 0;
+    uart_line_mode(0);
+}
+
+/**
+ * @brief answer every complete packet received so far, never waits for input
+ *
+ * @return 1 when the host asked for the text console, which line mode is
+ * already back on for, 0 otherwise
+ */
+int proto_poll(void) {
+    char c;
+    while (uart_get_byte(&c) == 0) {
+        if (c != 0) {
+            if (rx_len < sizeof(rx_buf)) {
+                rx_buf[rx_len++] = c;
+            } else {
+                rx_overflow = 1;
+            }
+            continue;
+        }
+        // empty packets are the 0x00 in front of each packet
+        if (rx_overflow) {
+            stats.framing_errors++;
+        } else if (rx_len > 0 && packet()) {
+            rx_len = 0;
+            uart_line_mode(1);
+            return 1;
+        }
+        rx_len = 0;
+        rx_overflow = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief packet counters since boot
+ *
+ * @param out  filled with the counters
+ */
+void proto_stats(proto_stats_t *out) {
+    *out = stats;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file rcc.c
+ *
+ * @brief bus clock frequencies derived from the RCC configuration
+ *
+ * @date 03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <rcc.h>
+
+/** @brief CFGR system clock switch status, bits 3:2 */
+#define RCC_CFGR_SWS(cfgr)    (((cfgr) >> 2) & 0x3)
+/** @brief CFGR AHB prescaler, bits 7:4 */
+#define RCC_CFGR_HPRE(cfgr)   (((cfgr) >> 4) & 0xF)
+/** @brief CFGR APB1 prescaler, bits 12:10 */
+#define RCC_CFGR_PPRE1(cfgr)  (((cfgr) >> 10) & 0x7)
+/** @brief CFGR APB2 prescaler, bits 15:13 */
+#define RCC_CFGR_PPRE2(cfgr)  (((cfgr) >> 13) & 0x7)
+/** @brief SWS value: HSE */
+#define RCC_SWS_HSE  (1)
+/** @brief SWS value: PLL */
+#define RCC_SWS_PLL  (2)
+
+/** @brief PLLCFGR fields */
+#define RCC_PLL_M(pll)        ((pll) & 0x3F)
+#define RCC_PLL_N(pll)        (((pll) >> 6) & 0x1FF)
+#define RCC_PLL_P(pll)        (((((pll) >> 16) & 0x3) + 1) * 2)
+#define RCC_PLL_SRC_HSE       (1 << 22)
+
+/** @brief AHB prescaler shift for HPRE 8-15 (/2 to /512, /32 skipped) */
+static const uint8_t hpre_shift[] = {1, 2, 3, 4, 6, 7, 8, 9};
+
+/**
+ * @brief  System clock frequency
+ *
+ * @return SYSCLK in Hz
+ */
+uint32_t rcc_sysclk_hz(void) {
+  struct rcc_reg_map *rcc = RCC_BASE;
+  uint32_t cfgr = rcc->cfgr;
+  switch (RCC_CFGR_SWS(cfgr)) {
+  case RCC_SWS_HSE:
+    return HSE_HZ;
+  case RCC_SWS_PLL: {
+    uint32_t pll = rcc->pll_cfgr;
+    uint32_t src = (pll & RCC_PLL_SRC_HSE) ? HSE_HZ : HSI_HZ;
+    uint32_t m = RCC_PLL_M(pll);
+    if (m == 0) return HSI_HZ;
+    return src / m * RCC_PLL_N(pll) / RCC_PLL_P(pll);
+  }
+  default:
+    return HSI_HZ;
+  }
+}
+
+/**
+ * @brief  AHB (HCLK) frequency
+ *
+ * @return HCLK in Hz
+ */
+uint32_t rcc_hclk_hz(void) {
+  struct rcc_reg_map *rcc = RCC_BASE;
+  uint32_t hpre = RCC_CFGR_HPRE(rcc->cfgr);
+  uint32_t sysclk = rcc_sysclk_hz();
+  return (hpre & 0x8) ? sysclk >> hpre_shift[hpre & 0x7] : sysclk;
+}
+
+/**
+ * apb_hz():
+ * @brief  HCLK divided by an APB prescaler field
+ */
+static uint32_t apb_hz(uint32_t ppre) {
+  uint32_t hclk = rcc_hclk_hz();
+  return (ppre & 0x4) ? hclk >> ((ppre & 0x3) + 1) : hclk;
+}
+
+/**
+ * @brief  APB1 peripheral clock frequency (USART2, TIM2-5, I2C)
+ *
+ * @return PCLK1 in Hz
+ */
+uint32_t rcc_apb1_hz(void) {
+  struct rcc_reg_map *rcc = RCC_BASE;
+  return apb_hz(RCC_CFGR_PPRE1(rcc->cfgr));
+}
+
+/**
+ * @brief  APB2 peripheral clock frequency (USART1, USART6)
+ *
+ * @return PCLK2 in Hz
+ */
+uint32_t rcc_apb2_hz(void) {
+  struct rcc_reg_map *rcc = RCC_BASE;
+  return apb_hz(RCC_CFGR_PPRE2(rcc->cfgr));
+}
@@ -3,166 +3,355 @@
  *
  * @brief functions for servo
  *
+ * Common servo API. The pulses themselves are produced by one of two
+ * backends selected at build time (see servo_hw.h):
+ *   - servo_pwm.c:   TIM2 compare outputs, two channels, no interrupts
+ *   - servo_sched.c: one timer scheduling edges for up to 16 GPIO pins
+ * Angles are turned into pulse widths with the per-channel calibration of
+ * servo_cal.c.
+ *
  * @date 03/15/2024
  *
  * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
  */
 
 #include <unistd.h>
-#include <gpio.h>
-#include <timer.h>
-#include <nvic.h>
-#include <printk.h>
-
-/** @brief define UNUSE for unuse parameters */
-#define UNUSED __attribute__((unused))
+#include <servo.h>
+#include <servo_hw.h>
+#ifndef LOG_LEVEL_SERVO
+#define LOG_LEVEL_SERVO LOG_LEVEL
+#endif
+#define LOG_MODULE_LEVEL LOG_LEVEL_SERVO
+#include <log.h>
+#include <arm.h>
 
-/** @brief macro for channel 0 pin */
-#define CHANNEL0_PIN (0)
-/** @brief macro for channel 1 pin */
-#define CHANNEL1_PIN (1)
-/** @brief macro for servo period */
-#define SERVO_PERIOD (200)
+/** @brief servo frames per second */
+#define SERVO_FRAME_HZ (1000000 / SERVO_FRAME_US)
+/** @brief deg/s to Q16 0.1 deg/frame is x * 65536 * 10 / 50 */
+#define VEL_DIV (SERVO_FRAME_HZ / 10)
+/** @brief deg/s^2 to Q16 0.1 deg/frame^2 */
+#define ACC_DIV (SERVO_FRAME_HZ * SERVO_FRAME_HZ / 10)
+/** @brief deg/s^3 to Q16 0.1 deg/frame^3 */
+#define JERK_DIV (SERVO_FRAME_HZ * SERVO_FRAME_HZ * SERVO_FRAME_HZ / 10)
+/** @brief fastest move in Q16 0.1 deg/frame, 1280 deg/s, so that the
+ * squared speed in motion_step() fits in 32 bits */
+#define VEL_MAX ((1 << 24) - 1)
+/** @brief 90 degree in Q16 0.1 degree, where the backends park the servos */
+#define SERVO_CENTER_Q16 ((SERVO_DECIDEG_MAX / 2) << 16)
 
 /**
- * ServoChannel:
- * @brief Set the the parameters of servo
+ * ServoMotion:
+ * @brief motion state of a channel, positions in Q16 0.1 degree, rates
+ * per 20 ms frame. Only touched by servo_frame() while moving is set.
  */
 typedef struct {
-    /** @brief define high tick when enable servo */
-    uint16_t high_tick;
-    /** @brief define low tick */
-    uint16_t low_tick;
-    /** @brief define current tick */
-    uint16_t current_tick;
-    /** @brief define port */
-    gpio_port port;
-    /** @brief define gpio_pin */
-    unsigned int gpio_pin;
-    /** @brief define enabled */
-    uint8_t enabled;
-    /** @brief define is_high  */
-    uint8_t is_high;
-} ServoChannel;
-
-/**
- * ServoChannel:
- * @brief Set the two servos parameters
- */
-ServoChannel servos[2] = {
-    {15, SERVO_PERIOD - 15, 0, GPIO_A, CHANNEL0_PIN, 0, 0},
-    {15, SERVO_PERIOD - 15, 0, GPIO_A, CHANNEL1_PIN, 0, 0}
+    /** @brief current position */
+    int32_t pos;
+    /** @brief current velocity, signed */
+    int32_t vel;
+    /** @brief current acceleration, signed, only used when jerk limited */
+    int32_t acc;
+    /** @brief position to reach */
+    int32_t target;
+    /** @brief velocity limit */
+    int32_t vmax;
+    /** @brief acceleration limit */
+    int32_t amax;
+    /** @brief jerk limit, 0 for a trapezoidal profile */
+    int32_t jmax;
+    /** @brief frames the acceleration needs to ramp up to amax */
+    int32_t lag;
+    /** @brief position the current move started from */
+    int32_t start;
+    /** @brief channel whose progress this one follows in a group move, -1 if none */
+    int8_t leader;
+    /** @brief decelerating into the target */
+    uint8_t braking;
+    /** @brief a move is in progress */
+    volatile uint8_t moving;
+} ServoMotion;
+
+/** @brief define enabled state of each channel */
+static uint8_t servo_enabled[SERVO_CHANNELS];
+
+/** @brief frames played since boot */
+static uint32_t frame_count = 0;
+
+/** @brief motion state of each channel */
+static ServoMotion motion[SERVO_CHANNELS] = {
+    [0 ... SERVO_CHANNELS - 1] = { .pos = SERVO_CENTER_Q16, .leader = -1 }
 };
 
 /**
- * ServoChannel:
- * @brief convert angle to period
+ * detach():
+ * @brief end any group the channel is in; followers stop where they are
  *
+ * Interrupts must be masked.
+ *
+ * @param channel  channel
+ * @param keep     followers the caller re-arms at once, as a mask of
+ *                 channels; they keep their velocity
  */
-uint16_t angle_to_tick(UNUSED uint8_t angle) {
-    // 0 degree is 0.6 ms and 180 degree is 2.4ms period is 20ms (50hz)
-    // prescalar is 1600, one tick every 0.1 ms, .. 6 tick for 0 and 24 tick for 180
-    return (6 + (0.1 * angle));
+static void detach(uint8_t channel, uint32_t keep) {
+    motion[channel].leader = -1;
+    for (int ch = 0; ch < SERVO_CHANNELS; ch++) {
+        if (motion[ch].leader == channel) {
+            motion[ch].leader = -1;
+            motion[ch].moving = 0;
+            if (!(keep & (1 << ch))) {
+                motion[ch].vel = 0;
+                motion[ch].acc = 0;
+            }
+        }
+    }
 }
 
 /**
- * tim2_irq_handler():
- * @brief Set time 5 interrupt requestion handler
+ * hold_at():
+ * @brief stop any move on a channel and record where it was put
  *
+ * @param channel  channel
+ * @param pos      new position in Q16 0.1 degree
  */
-void tim2_irq_handler() {
-    struct tim2_5* tim2 = timer_base[2];
-    ServoChannel *s1 = &servos[0];
-    if (tim2->sr & TIM_SR_UIF) {
-        if (1) {  
-            s1->current_tick++;
-            if (s1->is_high) {
-                if (s1->current_tick >= s1->high_tick) {
-                    gpio_clr(GPIO_A, CHANNEL0_PIN);
-                    s1->is_high = 0;
-                    s1->current_tick = 0;
-                }
-            } else {
-                if (s1->current_tick >= s1->low_tick) {
-                    gpio_set(GPIO_A, CHANNEL0_PIN);
-                    s1->is_high = 1;
-                    s1->current_tick = 0;
-                }
-            }
-        } 
-        timer_clear_interrupt_bit(2);
-    }
-}
-
-/**
- * tim5_irq_handler():
- * @brief Set time 5 interrupt requestion handler
- *
- */
-void tim5_irq_handler() {
-    struct tim2_5* tim5 = timer_base[5];
-    ServoChannel *s2 = &servos[1];
-    if (tim5->sr & TIM_SR_UIF) {
-        if (s2->enabled) {
-            s2->current_tick++;
-            if (s2->is_high) {
-                if (s2->current_tick >= s2->high_tick) {
-                    gpio_clr(GPIO_A, CHANNEL1_PIN);
-                    s2->is_high = 0;
-                    s2->current_tick = 0;
-                }
-            } else {
-                if (s2->current_tick >= s2->low_tick) {
-                    gpio_set(GPIO_A, CHANNEL1_PIN);
-                    s2->is_high = 1;
-                    s2->current_tick = 0;
-                }
-            }
-        } 
-        timer_clear_interrupt_bit(5);
-    }
+static void hold_at(uint8_t channel, int32_t pos) {
+    ServoMotion *m = &motion[channel];
+    uint32_t primask = irq_save();
+    detach(channel, 0);
+    m->moving = 0;
+    m->pos = pos;
+    m->vel = 0;
+    m->acc = 0;
+    irq_restore(primask);
 }
 
+/**
+ * move_limits():
+ * @brief convert user limits to Q16 0.1 degree per frame units, the
+ * velocity capped at VEL_MAX
+ *
+ * @return 0 on success or -1 when velocity or acceleration is zero
+ */
+static int move_limits(uint16_t max_vel, uint16_t max_acc, uint16_t max_jerk,
+                       int32_t *vmax, int32_t *amax, int32_t *jmax) {
+    if (max_vel == 0 || max_acc == 0) return -1;
+    *vmax = ((uint32_t)max_vel << 16) / VEL_DIV;
+    if (*vmax > VEL_MAX) *vmax = VEL_MAX;
+    *amax = ((uint32_t)max_acc << 16) / ACC_DIV;
+    *jmax = ((uint32_t)max_jerk << 16) / JERK_DIV;
+    if (*amax == 0) *amax = 1;
+    if (max_jerk != 0 && *jmax == 0) *jmax = 1;
+    return 0;
+}
 
 /**
- * @brief Enable or disable servo motor control
+ * start_move():
+ * @brief arm a profiled move from the current position and velocity
  *
- * @param channel  channel to enable or disable
- * @param enabled  1 to enable, 0 to disable
+ * Interrupts must be masked.
+ */
+static void start_move(ServoMotion *m, int32_t target, int32_t vmax, int32_t amax, int32_t jmax) {
+    m->start = m->pos;
+    m->target = target;
+    m->vmax = vmax;
+    m->amax = amax;
+    m->jmax = jmax;
+    m->lag = jmax ? amax / jmax : 0;
+    m->braking = 0;
+    if (!m->jmax) {
+        m->acc = 0;
+    }
+    m->moving = 1;
+}
+
+/**
+ * motion_step():
+ * @brief advance one move by one frame
  *
- * @return 0 on success or -1 on failure
+ * Accelerates toward the target until the distance left is what it takes
+ * to brake (plus the acceleration ramp when jerk limited), cruising at
+ * vmax in between. Everything is measured along the direction of the
+ * target so both directions share one code path.
+ *
+ * @param m  motion state, moving is set
  */
-int servo_enable(UNUSED uint8_t channel, UNUSED uint8_t enabled){
-    if (channel != 0 && channel != 1) {
-        printk("Invalid Channel\n");
-        return -1;
+static void motion_step(ServoMotion *m) {
+    int32_t d = m->target - m->pos;
+    int32_t dir = (d >= 0) ? 1 : -1;
+    int32_t sd = d * dir;
+    int32_t vd = m->vel * dir;
+    int32_t a = m->amax;
+    int32_t want;
+
+    if (vd <= 0) {
+        m->braking = 0;
+    }
+
+    // still accelerating under a jerk limit: the speed keeps rising while
+    // the acceleration ramps down, by ad * t / 2 over t = ad / jmax frames
+    int32_t ad0 = m->acc * dir;
+    int32_t vpeak = vd;
+    int64_t ramp = 0;
+    if (m->jmax != 0 && ad0 > 0) {
+        int32_t t = ad0 / m->jmax;
+        vpeak = vd + ad0 * t / 2;
+        ramp = (int64_t)(vd + vpeak) * t / 2;
+    }
+    // frames of decel from v sum to v*(v+a)/2a, the jerk ramp adds v*lag/2
+    int64_t brake = (int64_t)vpeak * (vpeak + a + (int64_t)a * m->lag);
+    if (vd > 0 && brake >= 2 * (int64_t)a * (sd - ramp)) {
+        m->braking = 1;
     }
 
-    ServoChannel *sc = &servos[channel];
-    sc->enabled = enabled;
-    if (enabled) {
-        if (channel == 0) {
-            timer_init(2, 100, 16);
+    int32_t ad;
+    if (m->jmax == 0) {
+        // trapezoid: full acceleration, cruise or full braking
+        if (m->braking) {
+            want = -a;
+            m->braking = 0;
         } else {
-            timer_init(5, 100, 16);
-        }
-        // when enabled, enable the periodic signal on the given channel
-        if (!sc->is_high) {
-            // gpio_set(sc->port, sc->gpio_pin);
-            sc->is_high = 1;
-            sc->current_tick = 0;
+            want = (vd < m->vmax) ? a : 0;
         }
+        ad = want;
     } else {
-        if (channel == 0) {
-            timer_disable(2);
+        // S-curve: once braking, ask for exactly the deceleration that stops
+        // at the target (vd^2 / 2sd, scaled to stay in 32 bits) so the
+        // ramp down to zero acceleration lands on it
+        if (m->braking) {
+            uint32_t den = (uint32_t)(2 * sd) >> 16;
+            uint32_t num = (uint32_t)(vd >> 8) * (uint32_t)(vd >> 8);
+            want = (den == 0 || num / den > (uint32_t)a) ? -a : -(int32_t)(num / den);
+        } else if (vd + (m->acc * dir) * m->lag / 2 < m->vmax) {
+            want = a;
+        } else {
+            want = 0;
+        }
+        // slew the acceleration by at most jmax per frame
+        ad = m->acc * dir;
+        if (ad < want) {
+            ad = (want - ad > m->jmax) ? ad + m->jmax : want;
+        } else if (ad > want) {
+            ad = (ad - want > m->jmax) ? ad - m->jmax : want;
+        }
+    }
+
+    vd += ad;
+    if (vd > m->vmax) {
+        vd = m->vmax;
+    }
+    if (m->jmax != 0 && m->braking && vd < a) {
+        // creep the last bit instead of stopping short and reversing
+        vd = a;
+        ad = 0;
+    }
+
+    if (vd >= sd || (sd <= a && vd <= a)) {
+        // within one step of the target
+        m->pos = m->target;
+        m->vel = 0;
+        m->acc = 0;
+        m->braking = 0;
+        m->moving = 0;
+        return;
+    }
+    m->pos += vd * dir;
+    m->vel = vd * dir;
+    m->acc = ad * dir;
+}
+
+/**
+ * @brief Advance every move by one frame
+ *
+ * Called by the backend from its timer interrupt once per 20 ms frame,
+ * early enough that the widths written here go out in the next frame.
+ */
+void servo_frame(void) {
+    // streamed setpoints land first, a move submitted by one starts now
+    servo_stream_frame(++frame_count);
+
+    for (int ch = 0; ch < SERVO_CHANNELS; ch++) {
+        ServoMotion *m = &motion[ch];
+        if (!m->moving || m->leader >= 0) continue;
+        motion_step(m);
+        servo_hw_set(ch, servo_cal_pos_us(ch, m->pos));
+    }
+
+    // group followers cover the same fraction of their distance as their
+    // leader, so they all land on the leader's last frame
+    for (int ch = 0; ch < SERVO_CHANNELS; ch++) {
+        ServoMotion *m = &motion[ch];
+        if (!m->moving || m->leader < 0) continue;
+        ServoMotion *lead = &motion[m->leader];
+        if (!lead->moving) {
+            m->pos = m->target;
+            m->vel = 0;
+            m->acc = 0;
+            m->moving = 0;
+            m->leader = -1;
         } else {
-            timer_disable(5);
+            int32_t span = (lead->target - lead->start) >> 16;
+            int32_t progress = (lead->pos - lead->start) / span;   // Q16
+            // a leader still coasting away from its target or overshooting
+            // must not drag the followers past their ends
+            if (progress < 0) progress = 0;
+            if (progress > (1 << 16)) progress = 1 << 16;
+            int32_t pos = m->start + (int32_t)(((int64_t)(m->target - m->start) * progress) >> 16);
+            // kept so a move that takes over mid-way starts from this speed
+            m->vel = pos - m->pos;
+            m->pos = pos;
         }
-        gpio_clr(sc->port, sc->gpio_pin);
-        sc->is_high = 0;
-        sc->current_tick = 0;   // reset the current tick
+        servo_hw_set(ch, servo_cal_pos_us(ch, m->pos));
+    }
+}
+
+/**
+ * @brief Output the position of a channel at rest after a recalibration
+ */
+void servo_refresh(uint8_t channel) {
+    uint32_t primask = irq_save();
+    if (!motion[channel].moving) {
+        servo_hw_set(channel, servo_cal_pos_us(channel, motion[channel].pos));
+    }
+    irq_restore(primask);
+}
+
+/**
+ * @brief Load the servo calibration, call once before any other servo
+ * function
+ */
+void servo_init(void) {
+    servo_cal_load();
+}
+
+/**
+ * @brief Enable or disable servo motor control
+ *
+ * @param channel  channel to enable or disable
+ * @param enabled  1 to enable, 0 to disable
+ *
+ * @return 0 on success or -1 on failure, also when UART_FLOW uses the pin
+ */
+int servo_enable(uint8_t channel, uint8_t enabled){
+    if (channel >= SERVO_CHANNELS) {
+        LOG_WARN_RL(1, 5, "Invalid Channel\n");
+        return -1;
+    }
+#ifdef UART_FLOW
+    // PA0 and PA1 carry the console CTS and RTS instead
+    if (enabled && channel < 2) {
+        LOG_WARN_RL(1, 5, "Channel %d pin used by UART flow control\n", channel + 1);
+        return -1;
     }
+#endif
 
+    enabled = enabled ? 1 : 0;
+    if (!enabled) {
+        // a disabled servo no longer follows its move
+        hold_at(channel, motion[channel].pos);
+    }
+    if (servo_enabled[channel] != enabled) {
+        servo_hw_enable(channel, enabled);
+        servo_enabled[channel] = enabled;
+    }
     return 0;
 }
 
@@ -175,11 +364,179 @@ int servo_enable(UNUSED uint8_t channel, UNUSED uint8_t enabled){
  *
  * @return 0 on success or -1 on failure
  */
-int servo_set(UNUSED uint8_t channel, UNUSED uint8_t angle){
-    if (channel > 1 || angle > 180) return -1;
-    ServoChannel *sc = &servos[channel];
-    uint16_t pulse_width = angle_to_tick(angle);
-    sc->high_tick = pulse_width;
-    sc->low_tick = SERVO_PERIOD - pulse_width; 
+int servo_set(uint8_t channel, uint8_t angle){
+    if (channel >= SERVO_CHANNELS || angle > 180) return -1;
+    hold_at(channel, (angle * 10) << 16);
+    servo_hw_set(channel, servo_cal_angle_us(channel, angle));
+    return 0;
+}
+
+/**
+ * @brief Set a servo motor to a position in 0.1 degree steps
+ *
+ * @param channel   channel to control
+ * @param decideg   servo angle in 0.1 degrees (0-1800)
+ *
+ * @return 0 on success or -1 on failure
+ */
+int servo_set_decideg(uint8_t channel, uint16_t decideg){
+    if (channel >= SERVO_CHANNELS || decideg > SERVO_DECIDEG_MAX) return -1;
+    hold_at(channel, decideg << 16);
+    servo_hw_set(channel, servo_cal_decideg_us(channel, decideg));
+    return 0;
+}
+
+/**
+ * @brief Set the raw pulse width of a servo motor
+ *
+ * @param channel   channel to control
+ * @param pulse_us  high time in us (SERVO_PULSE_MIN_US-SERVO_PULSE_MAX_US)
+ *
+ * @return 0 on success or -1 on failure
+ */
+int servo_set_us(uint8_t channel, uint16_t pulse_us){
+    if (channel >= SERVO_CHANNELS) return -1;
+    if (pulse_us < SERVO_PULSE_MIN_US || pulse_us > SERVO_PULSE_MAX_US) return -1;
+    // nearest angle, so a later servo_move() starts from here
+    hold_at(channel, servo_cal_us_decideg(channel, pulse_us) << 16);
+    servo_hw_set(channel, pulse_us);
+    return 0;
+}
+
+/**
+ * @brief Move a servo to a given position with limited speed
+ *
+ * The move starts from wherever the servo is (including mid-move) and is
+ * advanced from the servo timer interrupt once per frame.
+ *
+ * @param channel   channel to control, must be enabled
+ * @param angle     target angle in degrees (0-180)
+ * @param max_vel   velocity limit in deg/s, non-zero, at most 1280
+ * @param max_acc   acceleration limit in deg/s^2, non-zero
+ * @param max_jerk  jerk limit in deg/s^3, 0 for a trapezoidal profile
+ *
+ * @return 0 on success or -1 on failure
+ */
+int servo_move(uint8_t channel, uint8_t angle, uint16_t max_vel, uint16_t max_acc, uint16_t max_jerk){
+    if (channel >= SERVO_CHANNELS || angle > 180) return -1;
+    if (!servo_enabled[channel]) return -1;
+
+    int32_t vmax, amax, jmax;
+    if (move_limits(max_vel, max_acc, max_jerk, &vmax, &amax, &jmax) != 0) return -1;
+
+    uint32_t primask = irq_save();
+    detach(channel, 0);
+    start_move(&motion[channel], (angle * 10) << 16, vmax, amax, jmax);
+    irq_restore(primask);
+    return 0;
+}
+
+/**
+ * @brief Move several servos so that they all arrive on the same frame
+ *
+ * The channel with the longest travel runs a normal profiled move with
+ * the given limits. Every other channel follows its progress, which
+ * scales its velocity and acceleration by its share of the distance.
+ * All channels are armed inside one critical section, so they start on
+ * the same frame, and every frame updates them from the same interrupt.
+ * Like servo_move(), the leader starts from its current velocity and
+ * acceleration; a follower picks up its share of the leader's progress
+ * from where it is.
+ *
+ * @param count     number of channels
+ * @param channels  channels to move, each enabled and listed once
+ * @param angles    target angle in degrees (0-180) of each channel
+ * @param max_vel   velocity limit of the longest move in deg/s, non-zero, at most 1280
+ * @param max_acc   acceleration limit of the longest move in deg/s^2, non-zero
+ * @param max_jerk  jerk limit in deg/s^3, 0 for a trapezoidal profile
+ *
+ * @return 0 on success or -1 on failure
+ */
+int servo_move_group(uint8_t count, const uint8_t *channels, const uint8_t *angles,
+                     uint16_t max_vel, uint16_t max_acc, uint16_t max_jerk){
+    if (count == 0 || count > SERVO_CHANNELS || channels == NULL || angles == NULL) return -1;
+
+    uint32_t seen = 0;
+    for (int i = 0; i < count; i++) {
+        uint8_t ch = channels[i];
+        if (ch >= SERVO_CHANNELS || angles[i] > 180) return -1;
+        if (!servo_enabled[ch] || (seen & (1 << ch))) return -1;
+        seen |= (1 << ch);
+    }
+
+    int32_t vmax, amax, jmax;
+    if (move_limits(max_vel, max_acc, max_jerk, &vmax, &amax, &jmax) != 0) return -1;
+
+    uint32_t primask = irq_save();
+    int leader = -1;
+    int32_t longest = 0;
+    for (int i = 0; i < count; i++) {
+        ServoMotion *m = &motion[channels[i]];
+        detach(channels[i], seen);
+        int32_t dist = ((angles[i] * 10) << 16) - m->pos;
+        if (dist < 0) dist = -dist;
+        if (dist > longest) {
+            longest = dist;
+            leader = channels[i];
+        }
+    }
+    // below one step of 0.1 degree there is nothing to coordinate
+    if (longest < (1 << 16)) {
+        leader = -1;
+    }
+    for (int i = 0; i < count; i++) {
+        ServoMotion *m = &motion[channels[i]];
+        int32_t target = (angles[i] * 10) << 16;
+        if (leader < 0 || channels[i] == leader) {
+            start_move(m, target, vmax, amax, jmax);
+        } else {
+            m->start = m->pos;
+            m->target = target;
+            m->leader = leader;
+            m->moving = 1;
+        }
+    }
+    irq_restore(primask);
+    return 0;
+}
+
+/**
+ * @brief Poll whether the last servo_move() on a channel has finished
+ *
+ * @param channel   channel to query
+ *
+ * @return 1 when the servo is at rest, 0 while moving, -1 on failure
+ */
+int servo_move_done(uint8_t channel){
+    if (channel >= SERVO_CHANNELS) return -1;
+    return !motion[channel].moving;
+}
+
+/**
+ * @brief Read whether a channel is enabled, moving, and where it is
+ *
+ * @param channel  channel to query
+ * @param state    filled with the channel state
+ *
+ * @return 0 on success or -1 on failure
+ */
+int servo_get_state(uint8_t channel, servo_state_t *state){
+    if (channel >= SERVO_CHANNELS || state == NULL) return -1;
+    state->enabled = servo_enabled[channel];
+    state->moving = motion[channel].moving;
+    state->decideg = (motion[channel].pos + 0x8000) >> 16;
+    return 0;
+}
+
+/**
+ * @brief Read the servo interrupt timing of the selected backend
+ *
+ * @param stats  filled with the per-frame interrupt cost in CPU cycles
+ *
+ * @return 0 on success or -1 on failure
+ */
+int servo_isr_stats(servo_isr_stats_t *stats){
+    if (stats == NULL) return -1;
+    servo_hw_isr_stats(stats);
     return 0;
 }
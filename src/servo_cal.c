@@ -0,0 +1,302 @@
+/**
+ * @file servo_cal.c
+ *
+ * @brief per-channel servo calibration, kept in flash
+ *
+ * Every channel maps 0, 90 and 180 degree to its own pulse widths and is
+ * linear in between on each side of the center. The calibration is loaded
+ * from the configuration sector by servo_init() and turned into
+ *   - a 181 entry angle to width table per channel, so servo_set() is one
+ *     lookup, and
+ *   - a Q16 slope per half, so the frame interrupt converts motion
+ *     positions with one multiply.
+ *
+ * Records are appended to the configuration sector and the last valid one
+ * wins, so the sector is only erased once it is full. A save is ~35 word
+ * writes (about 0.5 ms with the CPU stalled), the occasional erase stalls
+ * it for 1-2 s, which the PWM backend rides out in hardware but the edge
+ * scheduler does not: its pins would stay high through the stall. With
+ * the edge scheduler a save is therefore refused while any channel is
+ * enabled, see servo_cal_can_save().
+ *
+ * @date 03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <servo.h>
+#include <servo_hw.h>
+#include <flash.h>
+#include <crc.h>
+#include <arm.h>
+
+/** @brief "SCAL" */
+#define CAL_MAGIC   (0x4C414353)
+/** @brief bumped whenever the record layout or checksum changes */
+#define CAL_VERSION (2)
+/** @brief channels stored in a record, independent of the backend */
+#define CAL_SLOTS   (16)
+/** @brief flash word of an erased sector */
+#define FLASH_ERASED (0xFFFFFFFF)
+
+/** @brief 90 degree in 0.1 degree */
+#define HALF_DECIDEG (SERVO_DECIDEG_MAX / 2)
+/** @brief 90 degree in Q16 0.1 degree */
+#define HALF_Q16     ((uint32_t)HALF_DECIDEG << 16)
+/** @brief entries of the whole degree lookup table */
+#define ANGLE_STEPS  (181)
+
+/**
+ * CalEntry:
+ * @brief one channel as stored in flash
+ */
+typedef struct {
+    uint16_t min_us;
+    uint16_t center_us;
+    uint16_t max_us;
+    uint16_t reserved;
+} CalEntry;
+
+/**
+ * CalRecord:
+ * @brief one saved calibration, a whole number of flash words
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t channels;
+    CalEntry entry[CAL_SLOTS];
+    /** @brief checksum of every word before it */
+    uint32_t checksum;
+} CalRecord;
+
+/** @brief words in a record */
+#define CAL_WORDS   (sizeof(CalRecord) / sizeof(uint32_t))
+/** @brief records that fit in the configuration sector */
+#define CAL_RECORDS (FLASH_CONFIG_SIZE / sizeof(CalRecord))
+
+/**
+ * CalScale:
+ * @brief conversion constants of a channel, read by the frame interrupt
+ */
+typedef struct {
+    uint16_t min_us;
+    uint16_t center_us;
+    uint16_t max_us;
+    /** @brief us per 0.1 degree below 90 degree, Q16 */
+    uint32_t lo_q16;
+    /** @brief us per 0.1 degree above 90 degree, Q16 */
+    uint32_t hi_q16;
+} CalScale;
+
+/** @brief conversion constants of each channel */
+static CalScale scale[SERVO_CHANNELS];
+/** @brief pulse width of every whole degree of each channel */
+static uint16_t angle_us[SERVO_CHANNELS][ANGLE_STEPS];
+/** @brief record slot the next save goes to */
+static uint32_t next_record = 0;
+
+/**
+ * cal_checksum():
+ * @brief CRC of the record words before the checksum
+ */
+static uint32_t cal_checksum(const CalRecord *rec) {
+    return crc_words((const uint32_t *)rec, CAL_WORDS - 1);
+}
+
+/**
+ * cal_valid():
+ * @brief check that the widths are ordered and in the accepted range
+ */
+static int cal_valid(uint16_t min_us, uint16_t center_us, uint16_t max_us) {
+    return min_us >= SERVO_PULSE_MIN_US && min_us < center_us &&
+           center_us < max_us && max_us <= SERVO_PULSE_MAX_US;
+}
+
+/**
+ * cal_apply():
+ * @brief install the calibration of one channel, already validated
+ */
+static void cal_apply(uint8_t channel, uint16_t min_us, uint16_t center_us, uint16_t max_us) {
+    CalScale s;
+    s.min_us = min_us;
+    s.center_us = center_us;
+    s.max_us = max_us;
+    s.lo_q16 = ((uint32_t)(center_us - min_us) << 16) / HALF_DECIDEG;
+    s.hi_q16 = ((uint32_t)(max_us - center_us) << 16) / HALF_DECIDEG;
+
+    uint32_t primask = irq_save();
+    scale[channel] = s;
+    irq_restore(primask);
+
+    // only the main loop reads the table, no need to mask the interrupt
+    for (int angle = 0; angle < ANGLE_STEPS; angle++) {
+        angle_us[channel][angle] = servo_cal_decideg_us(channel, angle * 10);
+    }
+}
+
+/**
+ * @brief load the last valid record from flash, defaults where there is none
+ */
+void servo_cal_load(void) {
+    const CalRecord *recs = (const CalRecord *)FLASH_CONFIG_BASE;
+    const CalRecord *found = NULL;
+
+    next_record = 0;
+    for (uint32_t i = 0; i < CAL_RECORDS; i++) {
+        const CalRecord *rec = &recs[i];
+        if (rec->magic == FLASH_ERASED) continue;
+        next_record = i + 1;
+        // a torn write is skipped, the one before it still counts
+        if (rec->magic == CAL_MAGIC && rec->version == CAL_VERSION &&
+            rec->checksum == cal_checksum(rec)) {
+            found = rec;
+        }
+    }
+
+    for (int ch = 0; ch < SERVO_CHANNELS; ch++) {
+        if (found != NULL && ch < found->channels) {
+            const CalEntry *e = &found->entry[ch];
+            if (cal_valid(e->min_us, e->center_us, e->max_us)) {
+                cal_apply(ch, e->min_us, e->center_us, e->max_us);
+                continue;
+            }
+        }
+        cal_apply(ch, SERVO_MIN_US, (SERVO_MIN_US + SERVO_MAX_US) / 2, SERVO_MAX_US);
+    }
+}
+
+/**
+ * @brief Read the calibration of a channel
+ *
+ * @param channel  channel to query
+ * @param cal      filled with the pulse widths at 0, 90 and 180 degree
+ *
+ * @return 0 on success or -1 on failure
+ */
+int servo_cal_get(uint8_t channel, servo_cal_t *cal) {
+    if (channel >= SERVO_CHANNELS || cal == NULL) return -1;
+    cal->min_us = scale[channel].min_us;
+    cal->center_us = scale[channel].center_us;
+    cal->max_us = scale[channel].max_us;
+    return 0;
+}
+
+/**
+ * @brief Recalibrate a channel, effective from the next frame
+ *
+ * A servo at rest is moved to where its current angle now maps to. Call
+ * servo_cal_save() to keep the change across resets.
+ *
+ * @param channel  channel to calibrate
+ * @param cal      pulse widths at 0, 90 and 180 degree, strictly
+ *                 increasing and within SERVO_PULSE_MIN_US-SERVO_PULSE_MAX_US
+ *
+ * @return 0 on success or -1 on failure
+ */
+int servo_cal_set(uint8_t channel, const servo_cal_t *cal) {
+    if (channel >= SERVO_CHANNELS || cal == NULL) return -1;
+    if (!cal_valid(cal->min_us, cal->center_us, cal->max_us)) return -1;
+    cal_apply(channel, cal->min_us, cal->center_us, cal->max_us);
+    servo_refresh(channel);
+    return 0;
+}
+
+/**
+ * @brief Check whether servo_cal_save() may stall the CPU now
+ *
+ * @return 1 when it may, 0 while the edge scheduler plays any channel
+ */
+int servo_cal_can_save(void) {
+#ifdef SERVO_SCHED
+    servo_state_t state;
+    for (int ch = 0; ch < SERVO_CHANNELS; ch++) {
+        if (servo_get_state(ch, &state) == 0 && state.enabled) return 0;
+    }
+#endif
+    return 1;
+}
+
+/**
+ * @brief Write the calibration of every channel to flash
+ *
+ * @return 0 on success or -1 on failure, also when servo_cal_can_save()
+ * refuses
+ */
+int servo_cal_save(void) {
+    if (!servo_cal_can_save()) return -1;
+
+    CalRecord rec;
+    rec.magic = CAL_MAGIC;
+    rec.version = CAL_VERSION;
+    rec.channels = SERVO_CHANNELS;
+    for (int ch = 0; ch < CAL_SLOTS; ch++) {
+        CalEntry *e = &rec.entry[ch];
+        if (ch < SERVO_CHANNELS) {
+            e->min_us = scale[ch].min_us;
+            e->center_us = scale[ch].center_us;
+            e->max_us = scale[ch].max_us;
+        } else {
+            e->min_us = 0;
+            e->center_us = 0;
+            e->max_us = 0;
+        }
+        e->reserved = 0;
+    }
+    rec.checksum = cal_checksum(&rec);
+
+    if (next_record >= CAL_RECORDS) {
+        if (flash_erase_sector(FLASH_CONFIG_SECTOR) != 0) return -1;
+        next_record = 0;
+    }
+    uint32_t addr = FLASH_CONFIG_BASE + next_record * sizeof(CalRecord);
+    // a failed write leaves a record load skips, move past it either way
+    next_record++;
+    if (flash_program(addr, (const uint32_t *)&rec, CAL_WORDS) != 0) return -1;
+    return (((const CalRecord *)addr)->checksum == rec.checksum) ? 0 : -1;
+}
+
+/**
+ * @brief pulse width of a whole degree angle, a table lookup
+ */
+uint16_t servo_cal_angle_us(uint8_t channel, uint8_t angle) {
+    return angle_us[channel][angle];
+}
+
+/**
+ * @brief pulse width of an angle in 0.1 degree steps
+ */
+uint16_t servo_cal_decideg_us(uint8_t channel, uint16_t decideg) {
+    const CalScale *s = &scale[channel];
+    if (decideg <= HALF_DECIDEG) {
+        return s->min_us + ((decideg * s->lo_q16 + 0x8000) >> 16);
+    }
+    return s->center_us + (((decideg - HALF_DECIDEG) * s->hi_q16 + 0x8000) >> 16);
+}
+
+/**
+ * @brief pulse width of a Q16 0.1 degree motion position
+ */
+uint16_t servo_cal_pos_us(uint8_t channel, int32_t pos) {
+    const CalScale *s = &scale[channel];
+    uint32_t p = (uint32_t)pos;
+    if (p <= HALF_Q16) {
+        return s->min_us + (uint16_t)(((uint64_t)p * s->lo_q16 + (1ULL << 31)) >> 32);
+    }
+    return s->center_us + (uint16_t)(((uint64_t)(p - HALF_Q16) * s->hi_q16 + (1ULL << 31)) >> 32);
+}
+
+/**
+ * @brief nearest angle in 0.1 degree of a pulse width, clamped to 0-180 degree
+ */
+uint16_t servo_cal_us_decideg(uint8_t channel, uint16_t pulse_us) {
+    const CalScale *s = &scale[channel];
+    if (pulse_us <= s->min_us) return 0;
+    if (pulse_us >= s->max_us) return SERVO_DECIDEG_MAX;
+    if (pulse_us <= s->center_us) {
+        return (uint32_t)(pulse_us - s->min_us) * HALF_DECIDEG / (s->center_us - s->min_us);
+    }
+    return HALF_DECIDEG +
+           (uint32_t)(pulse_us - s->center_us) * HALF_DECIDEG / (s->max_us - s->center_us);
+}
@@ -0,0 +1,159 @@
+/**
+ * @file servo_pwm.c
+ *
+ * @brief hardware PWM servo backend
+ *
+ * The servo pulses are generated by the capture/compare unit of TIM2, so
+ * the pulse itself takes no interrupt. The timer counts in us, so the
+ * compare value is the pulse width in us. The only interrupt is the 50 Hz
+ * update event at the start of each frame, which advances servo moves.
+ * PA0 and PA1 are TIM2_CH1 and TIM2_CH2 (AF1), which lets both channels
+ * share one 20 ms frame.
+ *
+ * The compare registers are never written by the CPU. Widths are staged in
+ * RAM and the same update event triggers a DMA burst (TIM2_UP, DMA1 stream
+ * 1 channel 3) that copies every staged width into CCR1..CCRn within the
+ * first us of the period, before any pulse could have ended. Every channel
+ * so changes on the same frame boundary and a pulse is never torn, however
+ * late the CPU writes.
+ *
+ * @date 03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifndef SERVO_SCHED
+
+#include <unistd.h>
+#include <gpio.h>
+#include <timer.h>
+#include <servo_hw.h>
+#include <dwt.h>
+#include <dma.h>
+
+/** @brief macro for channel 0 pin */
+#define CHANNEL0_PIN (0)
+/** @brief macro for channel 1 pin */
+#define CHANNEL1_PIN (1)
+/** @brief timer that generates the servo pulses */
+#define SERVO_TIMER (2)
+/** @brief DMA controller, stream and channel of the TIM2_UP request */
+#define SERVO_DMA (1)
+#define SERVO_DMA_STREAM (1)
+#define SERVO_DMA_CHANNEL (3)
+
+/**
+ * ServoChannel:
+ * @brief Set the the parameters of servo
+ */
+typedef struct {
+    /** @brief define port */
+    gpio_port port;
+    /** @brief define gpio_pin */
+    unsigned int gpio_pin;
+    /** @brief capture/compare channel of SERVO_TIMER driving the pin */
+    uint8_t tim_channel;
+    /** @brief alternate function routing the pin to the timer */
+    uint8_t alt;
+} ServoChannel;
+
+/**
+ * ServoChannel:
+ * @brief Set the two servos parameters
+ */
+static ServoChannel servos[SERVO_CHANNELS] = {
+    {GPIO_A, CHANNEL0_PIN, 1, ALT1},
+    {GPIO_A, CHANNEL1_PIN, 2, ALT1}
+};
+
+/**
+ * @brief compare values copied to CCR1..CCRn by the update DMA burst, so
+ * channel n of the table above has to be timer channel n + 1
+ */
+static volatile uint32_t ccr_stage[SERVO_CHANNELS] = {1500, 1500};
+
+/** @brief number of channels currently enabled, the timer runs while non-zero */
+static uint8_t servos_running = 0;
+
+/** @brief published cost of the frame interrupt */
+static volatile servo_isr_stats_t isr_stats;
+
+/**
+ * tim2_irq_handler():
+ * @brief frame start, compare values written here apply to the next frame
+ *
+ */
+void tim2_irq_handler() {
+    uint32_t start = dwt_cycles();
+    struct tim2_5* tim2 = timer_base[SERVO_TIMER];
+    if (tim2->sr & TIM_SR_UIF) {
+        tim2->sr = ~TIM_SR_UIF;
+        servo_frame();
+    }
+
+    // one interrupt per frame, so the frame total is this interrupt
+    uint32_t cycles = dwt_cycles() - start;
+    isr_stats.last_isr_max = cycles;
+    isr_stats.last_frame_total = cycles;
+    if (cycles > isr_stats.worst_frame_total) {
+        isr_stats.worst_frame_total = cycles;
+    }
+}
+
+/**
+ * @brief start or stop the TIM2 compare output of a channel
+ */
+void servo_hw_enable(uint8_t channel, uint8_t enabled) {
+    ServoChannel *sc = &servos[channel];
+    if (enabled) {
+        // hand the pin over to the timer
+        gpio_init(sc->port, sc->gpio_pin, MODE_ALT, OUTPUT_PUSH_PULL, OUTPUT_SPEED_LOW, PUPD_NONE, sc->alt);
+        if (servos_running++ == 0) {
+            dwt_init();
+            timer_pwm_init(SERVO_TIMER, SERVO_PRESCALAR, SERVO_FRAME_US);
+            // the first frame runs before the first burst
+            for (int ch = 0; ch < SERVO_CHANNELS; ch++) {
+                timer_set_compare(SERVO_TIMER, servos[ch].tim_channel, ccr_stage[ch]);
+            }
+            dma_init(SERVO_DMA);
+            dma_stream_start(SERVO_DMA, SERVO_DMA_STREAM,
+                             DMA_CR_CHSEL(SERVO_DMA_CHANNEL) | DMA_CR_PL_HIGH |
+                             DMA_CR_MSIZE_32 | DMA_CR_PSIZE_32 | DMA_CR_MINC |
+                             DMA_CR_CIRC | DMA_CR_DIR_M2P,
+                             &timer_base[SERVO_TIMER]->dmar, ccr_stage, SERVO_CHANNELS);
+            timer_dma_burst(SERVO_TIMER, TIM_DCR_CCR1, SERVO_CHANNELS, 1);
+            timer_update_irq(SERVO_TIMER, 1);
+        }
+        timer_pwm_channel(SERVO_TIMER, sc->tim_channel, 1);
+        // the burst lands right after the update event, so the value must
+        // apply to the period that just started rather than the next one
+        timer_compare_preload(SERVO_TIMER, sc->tim_channel, 0);
+    } else {
+        // hold the pin low, stop the timer once the last channel is off
+        timer_pwm_channel(SERVO_TIMER, sc->tim_channel, 0);
+        if (--servos_running == 0) {
+            timer_update_irq(SERVO_TIMER, 0);
+            timer_dma_burst(SERVO_TIMER, TIM_DCR_CCR1, SERVO_CHANNELS, 0);
+            dma_stream_stop(SERVO_DMA, SERVO_DMA_STREAM);
+            timer_disable(SERVO_TIMER);
+        }
+    }
+}
+
+/**
+ * @brief stage the width, the next update event's DMA burst applies it
+ */
+void servo_hw_set(uint8_t channel, uint16_t pulse_us) {
+    ccr_stage[channel] = pulse_us;
+}
+
+/**
+ * @brief copy the published frame interrupt timing
+ */
+void servo_hw_isr_stats(servo_isr_stats_t *stats) {
+    stats->last_isr_max = isr_stats.last_isr_max;
+    stats->last_frame_total = isr_stats.last_frame_total;
+    stats->worst_frame_total = isr_stats.worst_frame_total;
+}
+
+#endif /* SERVO_SCHED */
@@ -0,0 +1,280 @@
+/**
+ * @file servo_sched.c
+ *
+ * @brief single-timer edge scheduler servo backend
+ *
+ * Drives up to SERVO_CHANNELS servos on arbitrary GPIO pins from TIM5.
+ * Every 20 ms frame starts on the timer update event, which raises all
+ * enabled pins with one BSRR write per port. The channels are sorted by
+ * pulse width once per frame and compare channel 1 is stepped through the
+ * distinct falling edges, so a frame costs one interrupt per distinct edge
+ * instead of one per timer tick. The timer counts in us.
+ *
+ * The plan for the next frame is built right after the last edge of the
+ * current one, while the pins are idle, so the frame start interrupt only
+ * writes BSRR and arms the first edge.
+ *
+ * @date 03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#ifdef SERVO_SCHED
+
+#include <unistd.h>
+#include <gpio.h>
+#include <timer.h>
+#include <servo_hw.h>
+#include <dwt.h>
+
+/** @brief timer that schedules the servo edges */
+#define SERVO_TIMER (5)
+/** @brief edges closer than this to the counter are dropped immediately */
+#define EDGE_LATENCY_US (2)
+/** @brief number of GPIO ports a servo pin can live on */
+#define SERVO_PORTS (3)
+
+/**
+ * ServoPin:
+ * @brief where a servo channel is wired
+ */
+typedef struct {
+    /** @brief GPIO port */
+    gpio_port port;
+    /** @brief pin number 0-15 */
+    uint8_t pin;
+} ServoPin;
+
+/**
+ * @brief channel to (port, pin) table, edit to rewire the servos
+ *
+ * Keeps clear of the UART (PA2/PA3), LED (PA5), keypad (PA6-PA9, PB6,
+ * PC0, PC7), I2C (PB8/PB9) and debug (PA13/PA14, PB3) pins.
+ */
+static const ServoPin servo_pins[] = {
+    {GPIO_A, 0},  {GPIO_A, 1},  {GPIO_A, 4},  {GPIO_A, 10},
+    {GPIO_B, 0},  {GPIO_B, 1},  {GPIO_B, 2},  {GPIO_B, 4},
+    {GPIO_B, 5},  {GPIO_B, 10}, {GPIO_B, 12}, {GPIO_B, 13},
+    {GPIO_B, 14}, {GPIO_B, 15}, {GPIO_C, 1},  {GPIO_C, 2},
+};
+
+/** @brief fails to compile when the pin table and SERVO_CHANNELS disagree */
+typedef char servo_pins_size_check[
+    (sizeof(servo_pins) / sizeof(servo_pins[0]) == SERVO_CHANNELS) ? 1 : -1];
+
+/**
+ * ServoEdge:
+ * @brief one falling edge, every channel with the same width shares it
+ */
+typedef struct {
+    /** @brief counter value of the edge, us after frame start */
+    uint16_t time;
+    /** @brief pins to clear on each port */
+    uint16_t clr[SERVO_PORTS];
+} ServoEdge;
+
+/**
+ * ServoPlan:
+ * @brief everything the interrupt needs to play one frame
+ */
+typedef struct {
+    /** @brief pins to raise on each port at frame start */
+    uint16_t set[SERVO_PORTS];
+    /** @brief number of distinct edges */
+    uint8_t count;
+    /** @brief edges sorted by time */
+    ServoEdge edge[SERVO_CHANNELS];
+} ServoPlan;
+
+/** @brief pulse width of each channel in us, written by servo_hw_set() */
+static volatile uint16_t pulse_us[SERVO_CHANNELS] = {
+    [0 ... SERVO_CHANNELS - 1] = 1500
+};
+/** @brief bit per enabled channel */
+static volatile uint32_t enabled_mask = 0;
+/** @brief enabled pins of each port, keeps a just disabled channel low */
+static volatile uint16_t enabled_pins[SERVO_PORTS];
+
+/** @brief plan being played and plan for the next frame */
+static ServoPlan plans[2];
+/** @brief index of the plan being played */
+static uint8_t active = 0;
+/** @brief next edge of the active plan */
+static uint8_t next_edge = 0;
+/** @brief channels ordered by width, kept between frames so the sort is cheap */
+static uint8_t order[SERVO_CHANNELS];
+
+/** @brief cycles spent in the servo interrupt this frame */
+static uint32_t frame_total = 0;
+/** @brief longest servo interrupt this frame */
+static uint32_t frame_max = 0;
+/** @brief published timing of the last complete frame */
+static volatile servo_isr_stats_t isr_stats;
+
+/**
+ * build_plan():
+ * @brief sort the enabled channels by width and merge equal edges
+ *
+ * @param plan  plan to fill
+ */
+static void build_plan(ServoPlan *plan) {
+    uint32_t mask = enabled_mask;
+    uint16_t width[SERVO_CHANNELS];
+
+    for (int i = 0; i < SERVO_CHANNELS; i++) {
+        width[i] = pulse_us[i];
+    }
+    // insertion sort, nearly sorted from the previous frame
+    for (int i = 1; i < SERVO_CHANNELS; i++) {
+        uint8_t ch = order[i];
+        int j = i - 1;
+        while (j >= 0 && width[order[j]] > width[ch]) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = ch;
+    }
+
+    for (int p = 0; p < SERVO_PORTS; p++) {
+        plan->set[p] = 0;
+    }
+    plan->count = 0;
+    ServoEdge *edge = NULL;
+    for (int i = 0; i < SERVO_CHANNELS; i++) {
+        uint8_t ch = order[i];
+        if (!(mask & (1 << ch))) continue;
+        const ServoPin *sp = &servo_pins[ch];
+        if (edge == NULL || edge->time != width[ch]) {
+            edge = &plan->edge[plan->count++];
+            edge->time = width[ch];
+            for (int p = 0; p < SERVO_PORTS; p++) {
+                edge->clr[p] = 0;
+            }
+        }
+        edge->clr[sp->port] |= (1 << sp->pin);
+        plan->set[sp->port] |= (1 << sp->pin);
+    }
+}
+
+/**
+ * drop_edges():
+ * @brief clear the pins of every edge that is due and arm the next one
+ *
+ * @param tim  servo timer
+ */
+static void drop_edges(struct tim2_5 *tim) {
+    ServoPlan *plan = &plans[active];
+    while (next_edge < plan->count) {
+        ServoEdge *edge = &plan->edge[next_edge];
+        if (edge->time > tim->cnt + EDGE_LATENCY_US) {
+            tim->ccr[0] = edge->time;
+            return;
+        }
+        for (int p = 0; p < SERVO_PORTS; p++) {
+            if (edge->clr[p]) {
+                gpio_write_bsrr(p, (uint32_t)edge->clr[p] << 16);
+            }
+        }
+        next_edge++;
+    }
+    // frame done, advance the moves and prepare the next frame while
+    // every pin is low
+    tim->dier &= ~TIM_DIER_CC1IE;
+    servo_frame();
+    build_plan(&plans[active ^ 1]);
+}
+
+/**
+ * tim5_irq_handler():
+ * @brief frame start (update) and falling edges (compare 1)
+ *
+ */
+void tim5_irq_handler() {
+    uint32_t start = dwt_cycles();
+    struct tim2_5* tim = timer_base[SERVO_TIMER];
+    uint32_t sr = tim->sr;
+
+    if (sr & TIM_SR_UIF) {
+        tim->sr = ~TIM_SR_UIF;
+        // publish the timing of the frame that just ended
+        isr_stats.last_isr_max = frame_max;
+        isr_stats.last_frame_total = frame_total;
+        if (frame_total > isr_stats.worst_frame_total) {
+            isr_stats.worst_frame_total = frame_total;
+        }
+        frame_total = 0;
+        frame_max = 0;
+
+        active ^= 1;
+        next_edge = 0;
+        ServoPlan *plan = &plans[active];
+        for (int p = 0; p < SERVO_PORTS; p++) {
+            uint16_t set = plan->set[p] & enabled_pins[p];
+            if (set) {
+                gpio_write_bsrr(p, set);
+            }
+        }
+        tim->sr = ~TIM_SR_CC1IF;
+        tim->dier |= TIM_DIER_CC1IE;
+        drop_edges(tim);
+    } else if (sr & TIM_SR_CC1IF) {
+        tim->sr = ~TIM_SR_CC1IF;
+        drop_edges(tim);
+    }
+
+    uint32_t cycles = dwt_cycles() - start;
+    frame_total += cycles;
+    if (cycles > frame_max) {
+        frame_max = cycles;
+    }
+}
+
+/**
+ * @brief add or remove a channel from the schedule
+ *
+ * A channel joins at the start of a later frame. A disabled channel is
+ * pulled low right away in case it is in the middle of a pulse.
+ */
+void servo_hw_enable(uint8_t channel, uint8_t enabled) {
+    const ServoPin *sp = &servo_pins[channel];
+    if (enabled) {
+        gpio_init(sp->port, sp->pin, MODE_GP_OUTPUT, OUTPUT_PUSH_PULL, OUTPUT_SPEED_LOW, PUPD_NONE, ALT0);
+        gpio_clr(sp->port, sp->pin);
+        if (enabled_mask == 0) {
+            dwt_init();
+            for (int i = 0; i < SERVO_CHANNELS; i++) {
+                order[i] = i;
+            }
+            plans[0].count = 0;
+            plans[1].count = 0;
+            timer_init(SERVO_TIMER, SERVO_PRESCALAR, SERVO_FRAME_US);
+        }
+        enabled_pins[sp->port] |= (1 << sp->pin);
+        enabled_mask |= (1 << channel);
+    } else {
+        enabled_mask &= ~(1 << channel);
+        enabled_pins[sp->port] &= ~(1 << sp->pin);
+        gpio_clr(sp->port, sp->pin);
+        if (enabled_mask == 0) {
+            timer_disable(SERVO_TIMER);
+        }
+    }
+}
+
+/**
+ * @brief store the new width, picked up by the next frame's sort
+ */
+void servo_hw_set(uint8_t channel, uint16_t width_us) {
+    pulse_us[channel] = width_us;
+}
+
+/**
+ * @brief copy the published interrupt timing
+ */
+void servo_hw_isr_stats(servo_isr_stats_t *stats) {
+    stats->last_isr_max = isr_stats.last_isr_max;
+    stats->last_frame_total = isr_stats.last_frame_total;
+    stats->worst_frame_total = isr_stats.worst_frame_total;
+}
+
+#endif /* SERVO_SCHED */
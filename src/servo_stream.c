@@ -0,0 +1,163 @@
+/**
+ * @file servo_stream.c
+ *
+ * @brief timestamped servo setpoint streaming
+ *
+ * The host pushes (channel, angle, time) setpoints, the servo timer
+ * interrupt applies them at the frame they are due. The queue has one
+ * producer (the main loop, through servo_stream_push()) and one consumer
+ * (servo_stream_frame() in the servo interrupt), so it needs no lock:
+ * each side only writes its own index, and the producer publishes an
+ * entry only after it is written.
+ *
+ * @date 03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <servo.h>
+#include <servo_hw.h>
+#include <arm.h>
+
+/** @brief setpoint queue size, must be a power of 2 */
+#define STREAM_QUEUE_SIZE (64)
+/** @brief ms per servo frame */
+#define FRAME_MS (SERVO_FRAME_US / 1000)
+
+/**
+ * StreamPoint:
+ * @brief one queued setpoint
+ */
+typedef struct {
+    /** @brief servo frame the setpoint is due in */
+    uint32_t frame;
+    /** @brief position in 0.1 degree */
+    uint16_t decideg;
+    /** @brief channel */
+    uint8_t channel;
+} StreamPoint;
+
+/** @brief setpoint ring */
+static StreamPoint queue[STREAM_QUEUE_SIZE];
+/** @brief next entry to apply, only written by the interrupt */
+static volatile uint32_t head = 0;
+/** @brief next free entry, only written by the producer */
+static volatile uint32_t tail = 0;
+
+/** @brief frame that stream time 0 maps to */
+static volatile uint32_t base_frame = 0;
+/** @brief a stream is running, the interrupt applies its setpoints */
+static volatile uint8_t active = 0;
+/** @brief last frame seen by the interrupt */
+static volatile uint32_t now_frame = 0;
+
+/** @brief counters, written by whichever side detects the event */
+static volatile servo_stream_stats_t stats;
+
+/**
+ * @brief Called by servo_frame() once per frame: apply every due setpoint
+ *
+ * @param frame  frame number, increments by one per call
+ */
+void servo_stream_frame(uint32_t frame) {
+    now_frame = frame;
+    if (!active) return;
+
+    while (head != tail) {
+        StreamPoint *p = &queue[head & (STREAM_QUEUE_SIZE - 1)];
+        int32_t wait = (int32_t)(p->frame - frame);
+        if (wait > 0) break;
+        // missed its frame: pushed too late, or queued behind a later one
+        if (wait < 0) {
+            stats.underruns++;
+        }
+        servo_set_decideg(p->channel, p->decideg);
+        stats.applied++;
+        head = head + 1;
+    }
+}
+
+/**
+ * @brief Start a stream, time 0 is lead_ms from now
+ *
+ * Drops anything still queued and clears the counters. The lead time
+ * lets the host fill the queue before the first setpoint is due.
+ *
+ * @param lead_ms  delay before stream time 0
+ */
+void servo_stream_start(uint32_t lead_ms) {
+    uint32_t primask = irq_save();
+    active = 0;
+    head = tail;
+    stats.queued = 0;
+    stats.applied = 0;
+    stats.late = 0;
+    stats.underruns = 0;
+    stats.overruns = 0;
+    base_frame = now_frame + (lead_ms + FRAME_MS - 1) / FRAME_MS;
+    active = 1;
+    irq_restore(primask);
+}
+
+/**
+ * @brief Stop the stream, setpoints still queued are dropped
+ */
+void servo_stream_stop(void) {
+    uint32_t primask = irq_save();
+    active = 0;
+    head = tail;
+    irq_restore(primask);
+}
+
+/**
+ * @brief Queue a setpoint
+ *
+ * @param channel  channel to move
+ * @param decideg  position in 0.1 degree (0-1800)
+ * @param time_ms  stream time the setpoint is due at, rounded to a frame,
+ *                 at most SERVO_STREAM_MS_MAX
+ *
+ * @return 0 on success or -1 on a bad setpoint or a full queue
+ */
+int servo_stream_push(uint8_t channel, uint16_t decideg, uint32_t time_ms) {
+    if (channel >= SERVO_CHANNELS || decideg > SERVO_DECIDEG_MAX) return -1;
+    // keeps the due frame well inside the signed distance the interrupt compares
+    if (time_ms > SERVO_STREAM_MS_MAX) return -1;
+    if (tail - head >= STREAM_QUEUE_SIZE) {
+        stats.overruns++;
+        return -1;
+    }
+
+    uint32_t frame = base_frame + time_ms / FRAME_MS;
+    if ((int32_t)(frame - now_frame) <= 0) {
+        stats.late++;
+    }
+    StreamPoint *p = &queue[tail & (STREAM_QUEUE_SIZE - 1)];
+    p->frame = frame;
+    p->decideg = decideg;
+    p->channel = channel;
+    // the entry must be complete before the interrupt can see it
+    dmb();
+    tail = tail + 1;
+    stats.queued++;
+    return 0;
+}
+
+/**
+ * @brief Read the stream counters
+ *
+ * @param out  destination
+ *
+ * @return 0 on success or -1 on failure
+ */
+int servo_stream_stats(servo_stream_stats_t *out) {
+    if (out == NULL) return -1;
+    out->queued = stats.queued;
+    out->applied = stats.applied;
+    out->late = stats.late;
+    out->underruns = stats.underruns;
+    out->overruns = stats.overruns;
+    out->pending = tail - head;
+    return 0;
+}
@@ -0,0 +1,217 @@
+/**
+ * @file   shell.c
+ *
+ * @brief  table driven text command shell, see shell.h
+ *
+ * The line is tokenized in place in one pass: blanks become string ends,
+ * and every ';' or the end of the line runs the tokens collected so far.
+ * The command name is found by binary search of the sorted table, so the
+ * cost of a lookup grows with the log of the number of commands instead
+ * of walking a chain of string compares.
+ *
+ * @date   03/15/2024
+ *
+ * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <shell.h>
+#include <printk.h>
+
+/** @brief the command table, sorted by name */
+static const shell_cmd_t *table;
+/** @brief commands in table */
+static int table_len;
+
+/**
+ * @brief install the command table
+ *
+ * @param commands  table, sorted by name, kept by reference
+ * @param count     number of commands
+ *
+ * @return 0 on success or -1 when the table is not sorted, lookups would
+ * miss commands
+ */
+int shell_init(const shell_cmd_t *commands, int count) {
+    table = commands;
+    table_len = count;
+    for (int i = 1; i < count; i++) {
+        if (strcmp(commands[i - 1].name, commands[i].name) >= 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief parse a decimal integer, all of str, without atoi()
+ *
+ * @param str    digits with an optional leading - or +
+ * @param value  set to the number on success
+ *
+ * @return 0 on success or -1 when str is not a number or out of range
+ */
+int shell_parse_int(const char *str, int32_t *value) {
+    int neg = (*str == '-');
+    uint32_t v = 0;
+
+    if (*str == '-' || *str == '+') {
+        str++;
+    }
+    if (*str == '\0') {
+        return -1;
+    }
+    for (; *str != '\0'; str++) {
+        uint32_t d = (uint8_t)*str - '0';
+        if (d > 9) {
+            return -1;
+        }
+        // 0x7FFFFFFF, a negative number may go one further
+        if (v > 214748364 || (v == 214748364 && d > 7 + (uint32_t)neg)) {
+            return -1;
+        }
+        v = v * 10 + d;
+    }
+    *value = neg ? (int32_t)(0 - v) : (int32_t)v;
+    return 0;
+}
+
+/**
+ * find():
+ * @brief binary search of the table
+ *
+ * @return the command, or NULL when there is none of that name
+ */
+static const shell_cmd_t *find(const char *name) {
+    int lo = 0;
+    int hi = table_len - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) >> 1;
+        int cmp = strcmp(name, table[mid].name);
+        if (cmp == 0) {
+            return &table[mid];
+        }
+        if (cmp < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * convert():
+ * @brief check the arguments of a command against its schema
+ *
+ * @param cmd   the command
+ * @param n     arguments given
+ * @param argv  the arguments as text
+ * @param args  filled with the converted arguments
+ *
+ * @return 0 on success or -1 when they do not fit the schema
+ */
+static int convert(const shell_cmd_t *cmd, int n, char **argv, shell_arg_t *args) {
+    int i;
+    for (i = 0; cmd->schema[i] != '\0'; i++) {
+        char type = cmd->schema[i];
+        if (i >= n) {
+            // what is left must all be optional, uppercase
+            return (type == 'i' || type == 'w') ? -1 : 0;
+        }
+        if (type == 'i' || type == 'I') {
+            if (shell_parse_int(argv[i], &args[i].i) != 0) {
+                return -1;
+            }
+        } else {
+            args[i].s = argv[i];
+        }
+    }
+    return (n > i) ? -1 : 0;
+}
+
+/**
+ * execute():
+ * @brief run one command
+ *
+ * @param argc  tokens, the name included, at most SHELL_ARGS_MAX + 1
+ * @param argv  the tokens
+ *
+ * @return 0 on success or -1 on failure
+ */
+static int execute(int argc, char **argv) {
+    shell_arg_t args[SHELL_ARGS_MAX];
+    const shell_cmd_t *cmd = find(argv[0]);
+    if (cmd == NULL) {
+        printk("Invalid command %s\n", argv[0]);
+        return -1;
+    }
+
+    int status = SHELL_E_USAGE;
+    if (convert(cmd, argc - 1, argv + 1, args) == 0) {
+        status = cmd->handler(argc - 1, args);
+    }
+    if (status == SHELL_E_USAGE) {
+        printk("Usage: %s %s\n", cmd->name, cmd->usage);
+    }
+    return (status == 0) ? 0 : -1;
+}
+
+/**
+ * @brief run every command of a line
+ *
+ * @param line  commands separated by ';', modified by the tokenizer
+ *
+ * @return number of commands that failed
+ */
+int shell_run(char *line) {
+    char *argv[SHELL_ARGS_MAX + 1];
+    int argc = 0;
+    int failed = 0;
+    char *p = line;
+
+    for (;;) {
+        char c = *p;
+        if (c == ' ' || c == '\t' || c == '\r') {
+            *p++ = '\0';
+            continue;
+        }
+        if (c == ';' || c == '\n' || c == '\0') {
+            *p = '\0';
+            if (argc > SHELL_ARGS_MAX + 1) {
+                printk("Too many arguments for %s\n", argv[0]);
+                failed++;
+            } else if (argc > 0 && execute(argc, argv) != 0) {
+                failed++;
+            }
+            argc = 0;
+            if (c != ';') {
+                break;
+            }
+            p++;
+            continue;
+        }
+        // a token runs to the next blank, ';' or end of line
+        if (argc <= SHELL_ARGS_MAX) {
+            argv[argc] = p;
+        }
+        argc++;
+        while (*p != '\0' && *p != ' ' && *p != '\t' && *p != '\r' && *p != ';' && *p != '\n') {
+            p++;
+        }
+    }
+    return failed;
+}
+
+/**
+ * @brief print every command with its arguments and description
+ */
+void shell_help(void) {
+    for (int i = 0; i < table_len; i++) {
+        const shell_cmd_t *cmd = &table[i];
+        char name[40];
+        snprintk(name, sizeof(name), "%s %s", cmd->name, cmd->usage);
+        printk("  %-36s%s\n", name, cmd->help);
+    }
+}
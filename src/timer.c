@@ -121,6 +121,171 @@ void timer_clear_interrupt_bit(UNUSED int timer) {
   tim->sr &= ~1;
 }
 
+/**
+ *
+ * @brief  Starts the timer as a free running PWM time base (no interrupt)
+ *
+ *  timer      - The timer
+ *  prescaler  - Prescalar for clock
+ *  Period     - Period of the PWM frame in timer ticks
+ */
+void timer_pwm_init(int timer, uint32_t prescalar, uint32_t period) {
+  if (timer < 2 || timer > 5) return; // Check for valid timer
+  struct tim2_5* tim = timer_base[timer];
+  struct rcc_reg_map *rcc = RCC_BASE;
+  switch (timer)
+  {
+  case 2:
+    rcc->apb1_enr |= TIM2_CLKEN;
+    break;
+  case 3:
+    rcc->apb1_enr |= TIM3_CLKEN;
+    break;
+  case 4:
+    rcc->apb1_enr |= TIM4_CLKEN;
+    break;
+  case 5:
+    rcc->apb1_enr |= TIM5_CLKEN;
+    break;
+  default:
+    break;
+  }
+  tim->psc = prescalar - 1;
+  tim->arr = period - 1;
+  // buffer ARR so period changes land on the update event
+  tim->cr1 |= TIM_CR1_ARPE;
+  // load psc/arr into the shadow registers before starting
+  tim->egr = TIM_EGR_UG;
+  tim->cr1 |= 1; // Enable the timer
+}
+
+/**
+ *
+ * @brief  Turns the update (end of period) interrupt on or off
+ *
+ * @param timer      - The timer
+ * @param enabled    - 1 to enable, 0 to disable
+*/
+void timer_update_irq(int timer, int enabled) {
+  if (timer < 2 || timer > 5) return; // Check for valid timer
+  struct tim2_5* tim = timer_base[timer];
+  uint8_t irq_num = 0;
+  switch (timer)
+  {
+  case 2:
+    irq_num = TIM2_IRQ_NUMBER;
+    break;
+  case 3:
+    irq_num = TIM3_IRQ_NUMBER;
+    break;
+  case 4:
+    irq_num = TIM4_IRQ_NUMBER;
+    break;
+  case 5:
+    irq_num = TIM5_IRQ_NUMBER;
+    break;
+  default:
+    break;
+  }
+  if (enabled) {
+    tim->sr = ~TIM_SR_UIF;
+    tim->dier |= 1; // Update interrupt enable
+    nvic_irq(irq_num, IRQ_ENABLE);
+  } else {
+    tim->dier &= ~1;
+    nvic_irq(irq_num, IRQ_DISABLE);
+  }
+}
+
+/**
+ *
+ * @brief  Routes a capture/compare channel to its pin in PWM mode 1
+ *
+ * @param timer      - The timer
+ * @param channel    - capture/compare channel (1-4)
+ * @param enabled    - 1 to drive the pulse, 0 to force the output low
+*/
+void timer_pwm_channel(int timer, int channel, int enabled) {
+  if (timer < 2 || timer > 5 || channel < 1 || channel > 4) return;
+  struct tim2_5* tim = timer_base[timer];
+  // CH1/CH2 live in ccmr[0], CH3/CH4 in ccmr[1], 8 bits per channel
+  volatile uint32_t *ccmr = &tim->ccmr[(channel - 1) >> 1];
+  uint32_t shift = ((channel - 1) & 1) * 8;
+  uint32_t mode = enabled ? TIM_OCM_PWM1 : TIM_OCM_FORCE_LOW;
+
+  *ccmr = (*ccmr & ~(0xFF << shift)) | (((mode << 4) | TIM_OCPE) << shift);
+  if (enabled) {
+    tim->ccer |= (1 << ((channel - 1) * 4));
+  } else {
+    tim->ccer &= ~(1 << ((channel - 1) * 4));
+  }
+}
+
+/**
+ *
+ * @brief  Sets the compare value (pulse width) of a PWM channel
+ *
+ * With preload on, as timer_pwm_channel() sets it, the new value takes
+ * effect on the next update event and never cuts a pulse short. With
+ * preload off (timer_compare_preload()) it applies at once.
+ *
+ * @param timer      - The timer
+ * @param channel    - capture/compare channel (1-4)
+ * @param value      - pulse width in timer ticks
+*/
+void timer_set_compare(int timer, int channel, uint32_t value) {
+  if (timer < 2 || timer > 5 || channel < 1 || channel > 4) return;
+  timer_base[timer]->ccr[channel - 1] = value;
+}
+
+/**
+ *
+ * @brief  Turns the compare register preload of a channel on or off
+ *
+ * Without preload a new compare value applies to the running period, which
+ * is only safe when it is written right after the update event.
+ *
+ * @param timer      - The timer
+ * @param channel    - capture/compare channel (1-4)
+ * @param enabled    - 1 to buffer writes until the next update event
+*/
+void timer_compare_preload(int timer, int channel, int enabled) {
+  if (timer < 2 || timer > 5 || channel < 1 || channel > 4) return;
+  struct tim2_5* tim = timer_base[timer];
+  volatile uint32_t *ccmr = &tim->ccmr[(channel - 1) >> 1];
+  uint32_t bit = TIM_OCPE << (((channel - 1) & 1) * 8);
+  if (enabled) {
+    *ccmr |= bit;
+  } else {
+    *ccmr &= ~bit;
+  }
+}
+
+/**
+ *
+ * @brief  Sets up a DMA burst into consecutive timer registers on every
+ *         update event
+ *
+ * Each update event raises count DMA requests on the timer's UP request
+ * line, each writing DMAR, which the timer forwards to the next register
+ * of the burst. The DMA stream has to be set up by the caller.
+ *
+ * @param timer      - The timer
+ * @param base_reg   - first register as its offset / 4, e.g. TIM_DCR_CCR1
+ * @param count      - number of registers (1-18)
+ * @param enabled    - 1 to start bursting, 0 to stop
+*/
+void timer_dma_burst(int timer, uint32_t base_reg, uint32_t count, int enabled) {
+  if (timer < 2 || timer > 5 || count < 1 || count > 18) return;
+  struct tim2_5* tim = timer_base[timer];
+  if (enabled) {
+    tim->dcr = ((count - 1) << 8) | base_reg;
+    tim->dier |= TIM_DIER_UDE;
+  } else {
+    tim->dier &= ~TIM_DIER_UDE;
+  }
+}
+
 /** @brief set the led state */
 volatile uint8_t ledstate = 0;
 
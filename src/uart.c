@@ -3,6 +3,43 @@
  *
  * @brief  Interrupt and Console I/O
  *
+ * One driver serves every USART listed in uart_hw[]; each port has its own
+ * rings and line editor in a UartState, and its interrupts are routed to
+ * the shared handlers by the short vector functions at the end of the
+ * file. The uart_* functions without a port act on UART_CONSOLE.
+ *
+ * Transmit is DMA driven: uart_port_write() copies into a UART_TX_SIZE
+ * ring and the port's TX stream sends the oldest contiguous run of it. A
+ * run that wraps the end of the ring goes out as a second transfer
+ * started from the transfer complete interrupt, which is the only
+ * transmit interrupt.
+ *
+ * Receive is DMA driven as well: the RX stream fills a UART_RX_SIZE ring
+ * in circular mode on its own. The USART idle line interrupt, and the
+ * half/full transfer interrupts of the stream for bursts longer than half
+ * the ring, publish how far it got, so a burst of input costs one
+ * interrupt instead of one per byte. Overrun, framing and noise errors
+ * raise the USART interrupt too (CR3 EIE); it counts them and always
+ * clears the flags, so sustained bad input cannot keep it pending.
+ *
+ * In line mode (the default) those interrupts also run the line
+ * discipline: echo, backspace and line assembly. Finished lines wait in a
+ * queue of UART_LINE_QUEUE for uart_port_readline_nb(), so the main loop
+ * never blocks on the console. Echo from the interrupt and thread context
+ * writers share the transmit ring: a writer marks itself busy while it
+ * owns the tail, and echo produced meanwhile is parked and appended by
+ * its commit. printk() and LOG() from interrupt handlers reach the
+ * console the same way, through the log queue (logq.c), whose messages
+ * are appended after the echo.
+ *
+ * Optional RTS/CTS flow control (uart_port_flow_control()): CTS gates the
+ * transmitter in hardware (CR3 CTSE). RTS is a plain GPIO driven from the
+ * receive interrupts, because the hardware RTS only reacts to the data
+ * register, which the DMA keeps empty. It is deasserted once the unread
+ * bytes reach a high watermark and asserted again at half of it. With flow
+ * control on, a full line queue leaves input in the receive ring instead
+ * of dropping lines, so the host is held off rather than losing data.
+ *
  * @date   March 3rd
  *
  * @author Yuhong Yao (yuhongy), Yiying Li (yiyingl4)
@@ -11,256 +48,1091 @@
 #include <unistd.h>
 #include <rcc.h>
 #include <uart.h>
-#include <uart_polling.h>
+#include <uart_hw.h>
 #include <nvic.h>
 #include <gpio.h>
+#include <dma.h>
+#include <arm.h>
+#include <string.h>
+#include <logq.h>
+#include <systick.h>
 
 /** @brief define UNUSE for unuse parameters */
 #define UNUSED __attribute__((unused))
 
-/** @brief set the buffer size */
-#define BUFFER_SIZE (16)
-
-/** @brief The UART register map. */
-struct uart_reg_map {
-    volatile uint32_t SR;   /**< Status Register */
-    volatile uint32_t DR;   /**<  Data Register */
-    volatile uint32_t BRR;  /**<  Baud Rate Register */
-    volatile uint32_t CR1;  /**<  Control Register 1 */
-    volatile uint32_t CR2;  /**<  Control Register 2 */
-    volatile uint32_t CR3;  /**<  Control Register 3 */
-    volatile uint32_t GTPR; /**<  Guard Time and Prescaler Register */
-};
+/** @brief fails to compile unless both ring sizes are powers of two */
+typedef char uart_ring_size_check[
+    ((UART_TX_SIZE & (UART_TX_SIZE - 1)) == 0 &&
+     (UART_RX_SIZE & (UART_RX_SIZE - 1)) == 0) ? 1 : -1];
 
-/** @brief Base address for UART2 */
-#define UART2_BASE      (struct uart_reg_map *) 0x40004400
+/** @brief set the IDLEIE bit of CR1 in URAT. */
+#define UART_CR1_IDLEIE (1 << 4)
 
-/** @brief Enable Bit for UART Config register */
-#define UART_EN         (1 << 13)
+/** @brief CR3 DMA enable transmitter */
+#define UART_CR3_DMAT   (1 << 7)
 
-/** @brief Pre calculated UARTDIV value for desired band rate of 115200 bps by default */
-#define UARTDIV         0x8B
+/** @brief CR3 DMA enable receiver */
+#define UART_CR3_DMAR   (1 << 6)
 
-/** @brief Enable Bit for Transmitter */
-#define UART_TE         (1 << 3)
+/** @brief CR3 error interrupt enable, ORE, NF and FE in DMA mode */
+#define UART_CR3_EIE    (1 << 0)
 
-/** @brief Enable Bit for Receiver */
-#define UART_RE         (1 << 2)
+/** @brief receive errors counted by the USART interrupt */
+#define UART_SR_ERRORS  (UART_SR_ORE | UART_SR_NF | UART_SR_FE)
 
-/** @brief Transmit data register empty */
-#define UART_SR_TXE     (1 << 7)
+/** @brief CR3 CTS enable, transmission waits while CTS is high */
+#define UART_CR3_CTSE   (1 << 9)
 
-/** @brief Read data registter not empty */
-#define UART_SR_RXNE    (1 << 5)
+/**
+ * @brief default RTS high watermark. The fill level is only looked at on
+ * idle line and every half ring, so the watermark plus half a ring plus
+ * what the host sends after RTS drops (32 bytes) has to fit in the ring.
+ */
+#define UART_RTS_DEFAULT (UART_RX_SIZE / 2 - 32)
+
+/** @brief slack on top of the time a full transmit ring takes, in ms */
+#define UART_DRAIN_SLACK_MS (20)
 
-/** @brief set the RXNEIE bit of CR1 in URAT. */
-#define UART_CR1_RXNEIE (1 << 5)
+/** @brief longest input line including the newline and terminator */
+#define UART_LINE_MAX   (128)
+/** @brief finished lines waiting for uart_port_readline_nb(), a power of two */
+#define UART_LINE_QUEUE (4)
+/** @brief echo bytes parked while a thread writer owns the ring */
+#define UART_ECHO_MAX   (32)
 
-/** @brief set the TXEIE bit of CR1 in URAT. */
-#define UART_CR1_TXEIE  (1 << 7)
+/**
+ * @brief the USART instances, in uart_port order
+ *
+ * USART1 on PA9/PA10 shares PA9 with a keypad line and PA10 with servo
+ * channel 4 of the edge scheduler. The keypad is always built in, so
+ * USART1 cannot be opened on this board: uart_port_init() refuses it.
+ * The entry is kept for a board without the keypad. USART6 uses PA11/PA12 because PC7 is taken by the keypad, which
+ * are also USART1's CTS/RTS; USART6's own CTS/RTS are not on this package.
+ * USART2's CTS/RTS are PA0/PA1, the pins of servo channels 1 and 2.
+ * uart_port_init() and uart_port_flow_control() refuse pins in use, see
+ * board_pins.
+ */
+const UartHw uart_hw[UART_PORTS] = {
+    [UART_1] = {
+        .base = (struct uart_reg_map *)0x40011000, .irq = 37,
+        .apb2 = 1, .clk_en = USART1_CLKEN,
+        // TX is keypad row 3, so never free; RX is servo channel 4 under SERVO_SCHED
+        .tx_port = GPIO_A, .tx_pin = 9, .rx_port = GPIO_A, .rx_pin = 10, .alt = ALT7,
+        // CTS/RTS are USART6's TX/RX
+        .has_flow = 1, .cts_port = GPIO_A, .cts_pin = 11, .rts_port = GPIO_A, .rts_pin = 12,
+        .dma = 2, .dma_channel = 4, .tx_stream = 7, .rx_stream = 5,
+        .tx_dma_irq = 70, .rx_dma_irq = 68,
+    },
+    [UART_2] = {
+        .base = (struct uart_reg_map *)0x40004400, .irq = 38,
+        .apb2 = 0, .clk_en = UART_CLKEN,
+        .tx_port = GPIO_A, .tx_pin = 2, .rx_port = GPIO_A, .rx_pin = 3, .alt = ALT7,
+        .has_flow = 1, .cts_port = GPIO_A, .cts_pin = 0, .rts_port = GPIO_A, .rts_pin = 1,
+        .dma = 1, .dma_channel = 4, .tx_stream = 6, .rx_stream = 5,
+        .tx_dma_irq = 17, .rx_dma_irq = 16,
+    },
+    [UART_6] = {
+        .base = (struct uart_reg_map *)0x40011400, .irq = 71,
+        .apb2 = 1, .clk_en = USART6_CLKEN,
+        .tx_port = GPIO_A, .tx_pin = 11, .rx_port = GPIO_A, .rx_pin = 12, .alt = ALT8,
+        .has_flow = 0,
+        .dma = 2, .dma_channel = 5, .tx_stream = 6, .rx_stream = 1,
+        .tx_dma_irq = 69, .rx_dma_irq = 57,
+    },
+};
 
-/** @brief set the TCIE bit of CR1 in URAT. */
-#define UART_CR1_TCIE   (1 << 6)
+/** @brief mask of pin n of a GPIO port */
+#define PIN(n) (1 << (n))
 
-/** @brief set the number of IRQ in URAT. */
-#define UART_IRQ_NUMBER (38)
+/**
+ * @brief pins other drivers use, per GPIO port, which no USART may take:
+ * the keypad, the LED on PA5, the LCD's I2C on PB8/PB9 and the servo
+ * pins. Under UART_FLOW the console owns PA0/PA1 and servo_enable()
+ * refuses channels 1 and 2 instead.
+ */
+static const uint16_t board_pins[] = {
+    [GPIO_A] = PIN(5) | PIN(6) | PIN(7) | PIN(8) | PIN(9)
+#ifndef UART_FLOW
+             | PIN(0) | PIN(1)
+#endif
+#ifdef SERVO_SCHED
+             | PIN(4) | PIN(10)
+#endif
+             ,
+    [GPIO_B] = PIN(6) | PIN(8) | PIN(9)
+#ifdef SERVO_SCHED
+             | PIN(0) | PIN(1) | PIN(2) | PIN(4) | PIN(5) | PIN(10)
+             | PIN(12) | PIN(13) | PIN(14) | PIN(15)
+#endif
+             ,
+    [GPIO_C] = PIN(0) | PIN(7)
+#ifdef SERVO_SCHED
+             | PIN(1) | PIN(2)
+#endif
+             ,
+};
 
-/** @brief define Ring buffer */
+/**
+ * TxRing:
+ * @brief transmit ring, [head, head + dma_len) is being sent by the DMA
+ */
 typedef struct {
-    /** @brief Ring buffer size*/
-    unsigned char buffer[BUFFER_SIZE];
-    /** @brief define Ring buffer head */
+    /** @brief bytes to send */
+    unsigned char buffer[UART_TX_SIZE];
+    /** @brief oldest byte not yet sent, advanced by the DMA interrupt */
     volatile uint16_t head;
-    /** @brief define Ring buffer tail */
+    /** @brief next free byte, advanced by uart_port_write() */
     volatile uint16_t tail;
-} RingBuffer;
+    /** @brief length of the transfer in flight, 0 when the DMA is idle */
+    volatile uint16_t dma_len;
+} TxRing;
 
-/** @brief define txBuffer. */
-RingBuffer txBuffer;
-/** @brief define rxBuffer;. */
-RingBuffer rxBuffer;
+/**
+ * RxRing:
+ * @brief receive ring written by the DMA, byte n lives at n % UART_RX_SIZE
+ */
+typedef struct {
+    /** @brief bytes received */
+    unsigned char buffer[UART_RX_SIZE];
+    /** @brief bytes received since init, published by the interrupts */
+    volatile uint32_t received;
+    /** @brief bytes read since init */
+    uint32_t consumed;
+    /** @brief bytes the DMA overwrote before they were read */
+    uint32_t lost;
+    /** @brief overrun, noise and framing errors seen by the USART interrupt */
+    uint32_t overrun;
+    uint32_t noise;
+    uint32_t framing;
+} RxRing;
 
-/** @brief initialize ring buffer as empty by setting both head and tail to 0. */
-void RingBuffer_init(RingBuffer *rb) {
-    rb->head = 0;
-    rb->tail = 0;
-}
+/**
+ * LineQueue:
+ * @brief line editor state and finished lines, filled by the interrupts
+ */
+typedef struct {
+    /** @brief line being typed */
+    char edit[UART_LINE_MAX];
+    /** @brief characters in edit */
+    uint16_t edit_len;
+    /** @brief last character was '\r', so a following '\n' is the same line end */
+    uint8_t after_cr;
+    /** @brief finished, NUL terminated lines */
+    char line[UART_LINE_QUEUE][UART_LINE_MAX];
+    /** @brief lines finished since init, advanced by the interrupts */
+    volatile uint32_t head;
+    /** @brief lines read since init, advanced by uart_port_readline_nb() */
+    volatile uint32_t tail;
+    /** @brief lines dropped because the queue was full */
+    uint32_t dropped;
+} LineQueue;
 
-/** @brief check if the ring buffer is empty, if head equal to tail then it can be considered as empty. */
-int RingBuffer_isEmpty(RingBuffer *rb) {
-    return rb->head == rb->tail;
-}
+/**
+ * UartState:
+ * @brief everything the driver keeps per port
+ */
+typedef struct {
+    /** @brief define txBuffer. */
+    TxRing tx;
+    /** @brief define rxBuffer. */
+    RxRing rx;
+    /** @brief input lines */
+    LineQueue lines;
+    /** @brief the interrupts run the line discipline on received bytes */
+    volatile uint8_t line_mode;
+    /** @brief a thread writer is between reading the tail and committing */
+    volatile uint8_t tx_busy;
+    /** @brief bytes in echo_buf */
+    volatile uint8_t echo_len;
+    /** @brief echo waiting for the thread writer to commit */
+    char echo_buf[UART_ECHO_MAX];
+    /** @brief baud rate actually produced by the BRR setting, 0 while closed */
+    uint32_t actual_baud;
+    /** @brief RTS/CTS flow control is on */
+    uint8_t flow;
+    /** @brief RTS is deasserted, the host is held off */
+    uint8_t rts_off;
+    /** @brief unread bytes at which RTS is deasserted */
+    uint16_t rts_high;
+} UartState;
 
-/** @brief check if buffer is full, since mod or divid will take a lot cycles, use masks to determine if full when tail wrapped to head. */
-int RingBuffer_isFull(RingBuffer *rb) {
-    return (((rb->tail + 1) & (BUFFER_SIZE - 1)) == rb->head); 
-}
+/** @brief state of each port */
+static UartState uart_state[UART_PORTS];
 
-/** @brief add a byte to the buffer at tail. */
-int RingBuffer_Write(RingBuffer *rb, char data) {
-    if (RingBuffer_isFull(rb)) {
-        return -1; // buffer is full
+/**
+ * @brief uart_hw_setup: clock a port and hand its pins to it
+ *
+ * port  - port, already range checked
+ */
+void uart_hw_setup(uart_port port) {
+    const UartHw *hw = &uart_hw[port];
+    // Reset and Clock Control
+    struct rcc_reg_map *rcc = RCC_BASE;
+    if (hw->apb2) {
+        rcc->apb2_enr |= hw->clk_en;
+    } else {
+        rcc->apb1_enr |= hw->clk_en;
     }
-    // write at the tail
-    rb->buffer[rb->tail] = data;
-    rb->tail = (rb->tail + 1) & (BUFFER_SIZE - 1);
-    return 0;
+    // GPIO Pins
+    gpio_init(hw->tx_port, hw->tx_pin, MODE_ALT, OUTPUT_PUSH_PULL, OUTPUT_SPEED_LOW, PUPD_NONE, hw->alt);
+    gpio_init(hw->rx_port, hw->rx_pin, MODE_ALT, OUTPUT_OPEN_DRAIN, OUTPUT_SPEED_LOW, PUPD_NONE, hw->alt);
 }
 
-/** @brief read the buffer from head and advance the head. */
-int RingBuffer_Read(RingBuffer *rb, char *data) {
-    if (RingBuffer_isEmpty(rb)) {
+/**
+ * @brief uart_hw_brr: work out the BRR setting for a baud rate
+ *
+ * The divider f_pclk / baud is rounded to the nearest step. Oversampling
+ * by 16 is used while the divider is at least 16 (better noise margin),
+ * oversampling by 8 down to a divider of 8, which reaches f_pclk / 8
+ * (2 Mbaud at 16 MHz on APB1).
+ *
+ * port    - port, already range checked
+ * baud    - requested baud rate
+ * brr     - set to the BRR value
+ * over8   - set to UART_CR1_OVER8 or 0
+ * actual  - set to the baud rate really produced
+ *
+ * returns 0 on success or -1 when the clock cannot produce the rate
+ */
+int uart_hw_brr(uart_port port, uint32_t baud, uint32_t *brr, uint32_t *over8, uint32_t *actual) {
+    if (baud == 0) {
         return -1;
     }
-    *data = rb->buffer[rb->head];
-    rb->head = (rb->head + 1) & (BUFFER_SIZE - 1);
+    uint32_t pclk = uart_hw[port].apb2 ? rcc_apb2_hz() : rcc_apb1_hz();
+    uint32_t div = (pclk + baud / 2) / baud;
+    if (div >= 16 && div <= 0xFFFF) {
+        // 12 bit mantissa, 4 bit fraction: the divider itself
+        *brr = div;
+        *over8 = 0;
+    } else if (div >= 8 && div < 16) {
+        // 3 bit fraction, bit 3 stays clear
+        *brr = ((div >> 3) << 4) | (div & 0x7);
+        *over8 = UART_CR1_OVER8;
+    } else {
+        return -1;
+    }
+    *actual = pclk / div;
     return 0;
 }
 
+/**
+ * uart_pins():
+ * @brief pins a port drives on one GPIO port
+ *
+ * @param port  port
+ * @param gp    GPIO port
+ * @param flow  count the CTS/RTS pins as well
+ */
+static uint16_t uart_pins(uart_port port, gpio_port gp, int flow) {
+    const UartHw *hw = &uart_hw[port];
+    uint16_t mask = 0;
+    if (hw->tx_port == gp) {
+        mask |= PIN(hw->tx_pin);
+    }
+    if (hw->rx_port == gp) {
+        mask |= PIN(hw->rx_pin);
+    }
+    if (flow && hw->cts_port == gp) {
+        mask |= PIN(hw->cts_pin);
+    }
+    if (flow && hw->rts_port == gp) {
+        mask |= PIN(hw->rts_pin);
+    }
+    return mask;
+}
 
 /**
- * @brief uart_init: UART initialization function
- * baud  - baud rate
+ * @brief uart_hw_pins_free: check a port's pins against board_pins and
+ * the other open ports, before anything hands them to the USART
+ *
+ * port  - port, already range checked
+ * flow  - with its CTS/RTS pins
+ *
+ * returns 1 when none of them is in use, 0 otherwise
  */
-void uart_init(UNUSED int baud) {
+int uart_hw_pins_free(uart_port port, int flow) {
+    for (int gp = GPIO_A; gp <= GPIO_C; gp++) {
+        uint16_t used = board_pins[gp];
+        for (int other = 0; other < UART_PORTS; other++) {
+            if (other != (int)port && uart_state[other].actual_baud != 0) {
+                used |= uart_pins(other, gp, uart_state[other].flow);
+            }
+        }
+        if (uart_pins(port, gp, flow) & used) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief uart_port_init: UART initialization function
+ *
+ * port  - port to open
+ * baud  - baud rate, 0 only resets the rings
+ *
+ * returns 0 on success or -1 on failure, also when another driver or
+ * open port uses its pins
+ */
+int uart_port_init(uart_port port, uint32_t baud) {
+    if (port >= UART_PORTS || (baud != 0 && !uart_hw_pins_free(port, 0))) {
+        return -1;
+    }
+    UartState *st = &uart_state[port];
+    const UartHw *hw = &uart_hw[port];
+
     //init ring buffer
-    RingBuffer_init(&txBuffer);
-    RingBuffer_init(&rxBuffer);
+    st->tx.head = 0;
+    st->tx.tail = 0;
+    st->tx.dma_len = 0;
+    st->rx.received = 0;
+    st->rx.consumed = 0;
+    st->rx.lost = 0;
+    st->rx.overrun = 0;
+    st->rx.noise = 0;
+    st->rx.framing = 0;
+    st->lines.edit_len = 0;
+    st->lines.after_cr = 0;
+    st->lines.head = 0;
+    st->lines.tail = 0;
+    st->lines.dropped = 0;
+    st->line_mode = 1;
+    st->tx_busy = 0;
+    st->echo_len = 0;
+    st->flow = 0;
+    st->rts_off = 0;
 
     if (baud == 0) {
-        return;
+        return 0;
     }
-    struct uart_reg_map *uart = UART2_BASE;
-    // Reset and Clock Control
-    struct rcc_reg_map *rcc = RCC_BASE;
-    rcc->apb1_enr |= UART_CLKEN;
-    // GPIO Pins
-    gpio_init(GPIO_A, 2, MODE_ALT, OUTPUT_PUSH_PULL, OUTPUT_SPEED_LOW, PUPD_NONE, ALT7);        /* PA_2 for TX line UART2 */
-    gpio_init(GPIO_A, 3, MODE_ALT, OUTPUT_OPEN_DRAIN, OUTPUT_SPEED_LOW, PUPD_NONE, ALT7);       /* PA_2 for RX line UART2 */
-    
+    struct uart_reg_map *uart = hw->base;
+    uart_hw_setup(port);
+
     // Initialize UART to the desired Baud Rate
-    uart->BRR = UARTDIV;
+    if (uart_port_set_baud(port, baud, NULL) != 0) {
+        return -1;
+    }
+    // transmit through DMA, one interrupt per transfer
+    dma_init(hw->dma);
+    uart->CR3 |= UART_CR3_DMAT;
+    nvic_irq(hw->tx_dma_irq, IRQ_ENABLE);
+    // receive through circular DMA, the interrupts only publish progress
+    uart->CR3 |= UART_CR3_DMAR | UART_CR3_EIE;
+    dma_stream_start(hw->dma, hw->rx_stream,
+                     DMA_CR_CHSEL(hw->dma_channel) | DMA_CR_MINC | DMA_CR_CIRC |
+                     DMA_CR_DIR_P2M | DMA_CR_HTIE | DMA_CR_TCIE,
+                     &uart->DR, st->rx.buffer, UART_RX_SIZE);
+    nvic_irq(hw->rx_dma_irq, IRQ_ENABLE);
     // UART Control Registers
-    nvic_irq(UART_IRQ_NUMBER, IRQ_ENABLE);
-    uart->CR1 |= (UART_TE | UART_RE | UART_EN | UART_CR1_RXNEIE);
-    return;
+    nvic_irq(hw->irq, IRQ_ENABLE);
+    uart->CR1 |= (UART_TE | UART_RE | UART_EN | UART_CR1_IDLEIE);
+    if (port == UART_CONSOLE) {
+        // log queue messages from before now go out with the next PendSV
+        nvic_pend_sv_init();
+        nvic_pend_sv();
+    }
+    return 0;
 }
 
 /**
- * @brief uart_put_byte: transmits a byte over UART
- * c  - character to be sent
+ * @brief uart_port_set_baud: program the baud rate from the bus clock
+ *
+ * See uart_hw_brr() for how the divider is chosen. Output already queued
+ * is sent at the old rate first, waiting at most as long as a full ring
+ * takes; bytes arriving during the switch may be lost.
+ *
+ * port    - port
+ * baud    - requested baud rate
+ * actual  - if not NULL, set to the baud rate really produced
+ *
+ * returns 0 on success or -1 when the clock cannot produce the rate or
+ * the queued output did not drain in time (CTS held off), the old rate
+ * then stays
  */
-int uart_put_byte(UNUSED char c) {
-    struct uart_reg_map *uart = UART2_BASE;
-    int status = RingBuffer_Write(&txBuffer, c);
-    uart->CR1 |= UART_CR1_TXEIE;
-    return status;
+int uart_port_set_baud(uart_port port, uint32_t baud, uint32_t *actual) {
+    uint32_t brr, over8, rate;
+    if (port >= UART_PORTS || uart_hw_brr(port, baud, &brr, &over8, &rate) != 0) {
+        return -1;
+    }
+    UartState *st = &uart_state[port];
+    struct uart_reg_map *uart = uart_hw[port].base;
+    if (uart->CR1 & UART_EN) {
+        // let the queued output finish at the old rate, 10 bits a byte;
+        // the rate is unknown when uart_polling_init() enabled the port
+        uint32_t limit = UART_DRAIN_SLACK_MS;
+        if (st->actual_baud != 0) {
+            limit += UART_TX_SIZE * 10000 / st->actual_baud;
+        }
+        uint32_t start = systick_get_ticks();
+        while (st->tx.dma_len != 0 || st->tx.head != st->tx.tail || !(uart->SR & UART_SR_TC)) {
+            if (systick_get_ticks() - start > limit) {
+                return -1;
+            }
+        }
+        uart->CR1 &= ~UART_EN;
+        uart->BRR = brr;
+        uart->CR1 = (uart->CR1 & ~UART_CR1_OVER8) | over8;
+        uart->CR1 |= UART_EN;
+    } else {
+        uart->BRR = brr;
+        uart->CR1 = (uart->CR1 & ~UART_CR1_OVER8) | over8;
+    }
+    st->actual_baud = rate;
+    if (actual != NULL) {
+        *actual = rate;
+    }
+    return 0;
 }
 
 /**
- * @brief uart_get_byte: receives a byte over UART
- * c  - character to be sent
+ * @brief uart_port_get_baud: baud rate currently produced, 0 while closed
  */
-int uart_get_byte(UNUSED char *c) {
-    char data;
-    int status = RingBuffer_Read(&rxBuffer, &data);
-    if (status == 0) {
-        *c = data;
-        return 0;
+uint32_t uart_port_get_baud(uart_port port) {
+    return (port < UART_PORTS) ? uart_state[port].actual_baud : 0;
+}
+
+/**
+ * tx_kick():
+ * @brief start a transfer of the oldest contiguous run if the DMA is idle
+ *
+ * Interrupts must be masked.
+ */
+static void tx_kick(uart_port port) {
+    const UartHw *hw = &uart_hw[port];
+    TxRing *rb = &uart_state[port].tx;
+    uint16_t head = rb->head;
+    uint16_t tail = rb->tail;
+    if (rb->dma_len != 0 || head == tail) {
+        return;
     }
-    return status;
+    // stop at the end of the ring, the rest is the next transfer
+    uint16_t len = (tail > head) ? tail - head : UART_TX_SIZE - head;
+    rb->dma_len = len;
+    dma_stream_start(hw->dma, hw->tx_stream,
+                     DMA_CR_CHSEL(hw->dma_channel) | DMA_CR_MINC |
+                     DMA_CR_DIR_M2P | DMA_CR_TCIE | DMA_CR_TEIE,
+                     &hw->base->DR, &rb->buffer[head], len);
 }
 
 /**
- * @brief uart_write: support writing to stdout and return −1 if this is not the case
- * 
+ * tx_space():
+ * @brief free bytes in the transmit ring
  */
-int uart_write(UNUSED int file, UNUSED char *ptr, UNUSED int len) {
-    if (file != STDOUT_FILENO) {
-        return -1;
+static int tx_space(const TxRing *rb, uint16_t tail) {
+    // one slot stays empty so a full ring is not mistaken for an empty one
+    return (rb->head - tail - 1) & (UART_TX_SIZE - 1);
+}
+
+/**
+ * echo_flush():
+ * @brief append the parked echo at the tail, dropping what does not fit,
+ * and on the console the log queue messages that fit whole
+ *
+ * Interrupts must be masked and no thread writer may own the tail.
+ */
+static void echo_flush(uart_port port) {
+    UartState *st = &uart_state[port];
+    TxRing *rb = &st->tx;
+    uint16_t tail = rb->tail;
+    for (int i = 0; i < st->echo_len; i++) {
+        if (((tail + 1) & (UART_TX_SIZE - 1)) == rb->head) {
+            break;
+        }
+        rb->buffer[tail] = st->echo_buf[i];
+        tail = (tail + 1) & (UART_TX_SIZE - 1);
     }
+    st->echo_len = 0;
 
-    for (int i = 0; i < len; i++) {
-        if (uart_put_byte(ptr[i]) == -1) {
-            return -1;
+    const char *msg;
+    int len;
+    // the rest stays queued until the DMA frees room
+    while (port == UART_CONSOLE && (msg = logq_peek(&len)) != NULL &&
+           len <= tx_space(rb, tail)) {
+        int first = UART_TX_SIZE - tail;
+        if (first > len) {
+            first = len;
         }
+        memcpy(&rb->buffer[tail], msg, first);
+        memcpy(&rb->buffer[0], msg + first, len - first);
+        tail = (tail + len) & (UART_TX_SIZE - 1);
+        logq_pop();
     }
-    return len;
+    dmb();
+    rb->tail = tail;
+    tx_kick(port);
 }
 
 /**
- * @brief uart_read: support reading from stdin and return −1 if this is not the case
- * 
+ * echo():
+ * @brief send line editor echo from the receive interrupt
  */
-int uart_read(UNUSED int file, char *ptr, int len) {
-    if (file != STDIN_FILENO) {
-        return -1;
+static void echo(uart_port port, const char *str, int len) {
+    UartState *st = &uart_state[port];
+    for (int i = 0; i < len && st->echo_len < UART_ECHO_MAX; i++) {
+        st->echo_buf[st->echo_len++] = str[i];
     }
-    
-    int byteRead = 0;
-    char c;
-    while (1) {  // Keep reading until we get a newline
-        if (uart_get_byte(&c) != 0) {
-            continue;  // If no byte was read, try again
+    if (!st->tx_busy) {
+        echo_flush(port);
+    }
+}
+
+/**
+ * line_input():
+ * @brief feed one received character to the line editor
+ */
+static void line_input(uart_port port, char c) {
+    LineQueue *lq = &uart_state[port].lines;
+    if (c == '\n' && lq->after_cr) {
+        // second half of a CRLF
+        lq->after_cr = 0;
+        return;
+    }
+    lq->after_cr = (c == '\r');
+
+    if (c == '\r' || c == '\n' || c == 4) {
+        if (c != 4) {
+            lq->edit[lq->edit_len++] = '\n';
+            echo(port, "\r\n", 2);
         }
-        
-        if (c == 4) {
-            break;
-        } else if (c == '\b') {
-            if (byteRead > 0) {
-                byteRead--;
-                uart_write(STDOUT_FILENO, "\b \b", 3);
-            }
-        } else if (c == '\r' || c == '\n') {
-            ptr[byteRead++] = '\n';
-            uart_write(STDOUT_FILENO, "\r\n", 2);
-            break;
+        if (lq->head - lq->tail < UART_LINE_QUEUE) {
+            char *dst = lq->line[lq->head & (UART_LINE_QUEUE - 1)];
+            memcpy(dst, lq->edit, lq->edit_len);
+            dst[lq->edit_len] = '\0';
+            dmb();
+            lq->head++;
         } else {
-            if (byteRead < len - 1) {  // Make sure we don't overflow the buffer
-                ptr[byteRead++] = c;
-                uart_write(STDOUT_FILENO, &c, 1);
-            }
+            lq->dropped++;
         }
+        lq->edit_len = 0;
+    } else if (c == '\b' || c == 0x7F) {
+        if (lq->edit_len > 0) {
+            lq->edit_len--;
+            echo(port, "\b \b", 3);
+        }
+    } else if (lq->edit_len < UART_LINE_MAX - 2) {
+        // room is kept for the newline and the terminator
+        lq->edit[lq->edit_len++] = c;
+        echo(port, &c, 1);
     }
-    ptr[byteRead] = '\0';  // Null-terminate the string
-    return byteRead;
 }
 
+/**
+ * tx_dma_irq():
+ * @brief a transmit transfer finished, release its bytes and send
+ * whatever was queued meanwhile
+ */
+static void tx_dma_irq(uart_port port) {
+    const UartHw *hw = &uart_hw[port];
+    UartState *st = &uart_state[port];
+    TxRing *rb = &st->tx;
+    dma_clear_flags(hw->dma, hw->tx_stream, DMA_ALL_FLAGS);
+    rb->head = (rb->head + rb->dma_len) & (UART_TX_SIZE - 1);
+    rb->dma_len = 0;
+    if (!st->tx_busy) {
+        // room was freed, take log messages that were waiting for it
+        echo_flush(port);
+    } else {
+        tx_kick(port);
+    }
+}
 
 /**
- * @brief uart_irq_handler: to handle the interrupt request (both receive and transmit)
- * 
+ * rx_take():
+ * @brief take the oldest unread byte
+ *
+ * @return 0 on success or -1 when nothing is unread
  */
-void uart_irq_handler() {
-    struct uart_reg_map *uart = UART2_BASE;
-    int transmitCount = 0;
-    int receiveCount = 0;
+static int rx_take(uart_port port, char *c) {
+    RxRing *rb = &uart_state[port].rx;
+    uint32_t received = rb->received;
+    if (rb->consumed == received) {
+        return -1;
+    }
+    // the DMA lapped the reader, skip to the oldest byte still there
+    if (received - rb->consumed > UART_RX_SIZE) {
+        rb->lost += received - rb->consumed - UART_RX_SIZE;
+        rb->consumed = received - UART_RX_SIZE;
+    }
+    *c = rb->buffer[rb->consumed & (UART_RX_SIZE - 1)];
+    rb->consumed++;
+    return 0;
+}
 
-    // Handle Transmission
-    while ((uart->SR & UART_SR_TXE) && (transmitCount < 16)) {
-        if (!RingBuffer_isEmpty(&txBuffer)) {
-            char data;
-            if (RingBuffer_Read(&txBuffer, &data) == 0) {
-                uart->DR = data;
-                transmitCount++;
-            }
-        } else {
-            uart->CR1 &= ~UART_CR1_TXEIE;
+/**
+ * rx_flow():
+ * @brief drive RTS from the number of unread bytes
+ *
+ * Interrupts must be masked.
+ */
+static void rx_flow(uart_port port) {
+    UartState *st = &uart_state[port];
+    const UartHw *hw = &uart_hw[port];
+    if (!st->flow) {
+        return;
+    }
+    uint32_t unread = st->rx.received - st->rx.consumed;
+    if (!st->rts_off && unread >= st->rts_high) {
+        gpio_set(hw->rts_port, hw->rts_pin);
+        st->rts_off = 1;
+    } else if (st->rts_off && unread <= st->rts_high / 2) {
+        gpio_clr(hw->rts_port, hw->rts_pin);
+        st->rts_off = 0;
+    }
+}
+
+/**
+ * rx_lines():
+ * @brief run the line discipline over the unread bytes
+ *
+ * With flow control on it stops while the line queue is full and leaves
+ * the rest unread for RTS to account for. Interrupts must be masked.
+ */
+static void rx_lines(uart_port port) {
+    UartState *st = &uart_state[port];
+    LineQueue *lq = &st->lines;
+    char c;
+    while (st->line_mode) {
+        if (st->flow && lq->head - lq->tail >= UART_LINE_QUEUE) {
+            break;
+        }
+        if (rx_take(port, &c) != 0) {
             break;
         }
+        line_input(port, c);
     }
+}
 
-    // Handle Reception
-    while ((uart->SR & UART_SR_RXNE) && (receiveCount < 16)) {
-        char data = uart->DR; // Reading DR clears the RXNE flag
-        if (!RingBuffer_isFull(&rxBuffer)) {
-            RingBuffer_Write(&rxBuffer, data);
-            receiveCount++;
-        } else {
-            // Buffer is full, can't receive more data, break the loop
-            break;
+/**
+ * rx_publish():
+ * @brief advance the received count to where the DMA is writing
+ *
+ * Called from the idle line and the receive DMA interrupts, often enough
+ * that the DMA never gets more than half a ring ahead between two calls.
+ */
+static void rx_publish(uart_port port) {
+    const UartHw *hw = &uart_hw[port];
+    RxRing *rb = &uart_state[port].rx;
+    uint32_t pos = UART_RX_SIZE - dma_stream(hw->dma, hw->rx_stream)->ndtr;
+    uint32_t last = rb->received & (UART_RX_SIZE - 1);
+    rb->received += (pos - last) & (UART_RX_SIZE - 1);
+
+    rx_lines(port);
+    rx_flow(port);
+}
+
+/**
+ * rx_dma_irq():
+ * @brief the receive DMA reached the middle or the end of the ring
+ */
+static void rx_dma_irq(uart_port port) {
+    const UartHw *hw = &uart_hw[port];
+    dma_clear_flags(hw->dma, hw->rx_stream, DMA_ALL_FLAGS);
+    rx_publish(port);
+}
+
+/**
+ * usart_irq():
+ * @brief the line went idle after a burst or a receive error occurred,
+ * publish what the receive DMA stored
+ */
+static void usart_irq(uart_port port) {
+    const UartHw *hw = &uart_hw[port];
+    struct uart_reg_map *uart = hw->base;
+    RxRing *rb = &uart_state[port].rx;
+    uint32_t sr = uart->SR;
+
+    if (sr & (UART_SR_IDLE | UART_SR_ERRORS)) {
+        if (sr & UART_SR_ORE) rb->overrun++;
+        if (sr & UART_SR_NF) rb->noise++;
+        if (sr & UART_SR_FE) rb->framing++;
+        // reading SR then DR clears IDLE and the errors. While a byte is
+        // waiting (RXNE) the DMA's own read of DR completes the sequence,
+        // reading it here would take the byte away from the ring.
+        if (!(uart->SR & UART_SR_RXNE)) {
+            (void)uart->DR;
         }
+        rx_publish(port);
+    }
+
+    nvic_clear_pending(hw->irq);
+}
+
+/**
+ * @brief uart_port_get_byte: receives a byte over UART
+ *
+ * Only for ports with the line discipline turned off, otherwise the
+ * interrupts consume the input.
+ *
+ * port  - port
+ * c     - set to the received byte
+ *
+ * returns 0 on success or -1 when nothing arrived
+ */
+int uart_port_get_byte(uart_port port, char *c) {
+    if (port >= UART_PORTS) {
+        return -1;
+    }
+    int status = rx_take(port, c);
+    if (uart_state[port].flow) {
+        uint32_t primask = irq_save();
+        rx_flow(port);
+        irq_restore(primask);
+    }
+    return status;
+}
+
+/**
+ * tx_commit():
+ * @brief publish len bytes written at the tail and start the DMA if idle
+ */
+static void tx_commit(uart_port port, uint16_t tail, int len) {
+    UartState *st = &uart_state[port];
+    // the bytes must be in memory before the DMA can be pointed at them
+    dmb();
+    uint32_t primask = irq_save();
+    st->tx.tail = (tail + len) & (UART_TX_SIZE - 1);
+    st->tx_busy = 0;
+    echo_flush(port);
+    irq_restore(primask);
+}
+
+/**
+ * @brief uart_port_write: queue bytes for sending
+ *
+ * Never waits: copies as much of ptr as fits in the transmit ring (at most
+ * two memcpy around the wrap) and starts the DMA if it was idle. The copy
+ * runs with interrupts enabled, so only thread context may call it.
+ *
+ * returns the number of bytes queued, which is short of len when the ring
+ * fills up, or -1 on failure
+ */
+int uart_port_write(uart_port port, const char *ptr, int len) {
+    if (port >= UART_PORTS || len < 0) {
+        return -1;
+    }
+    UartState *st = &uart_state[port];
+    TxRing *rb = &st->tx;
+    st->tx_busy = 1;
+    uint16_t tail = rb->tail;
+    int space = tx_space(rb, tail);
+    if (len > space) {
+        len = space;
+    }
+    int first = UART_TX_SIZE - tail;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(&rb->buffer[tail], ptr, first);
+    memcpy(&rb->buffer[0], ptr + first, len - first);
+    tx_commit(port, tail, len);
+    return len;
+}
+
+/**
+ * @brief uart_port_reserve: lend out free transmit ring memory so a
+ * producer can build its output in place
+ *
+ * The span is contiguous, so it stops at the end of the ring; reserve
+ * again after committing to get the part after the wrap. Nothing is sent
+ * until uart_port_commit(), which must follow every reservation, even
+ * with 0 bytes. Thread context only, like uart_port_write().
+ *
+ * port  - port, already opened
+ * span  - set to the first free byte
+ * len   - bytes wanted
+ *
+ * returns the number of bytes granted, 0 when the ring is full or the
+ * port does not exist
+ */
+int uart_port_reserve(uart_port port, char **span, int len) {
+    if (port >= UART_PORTS) {
+        return 0;
+    }
+    UartState *st = &uart_state[port];
+    TxRing *rb = &st->tx;
+    st->tx_busy = 1;
+    uint16_t tail = rb->tail;
+    int space = tx_space(rb, tail);
+    if (len > space) {
+        len = space;
     }
+    if (len > UART_TX_SIZE - tail) {
+        len = UART_TX_SIZE - tail;
+    }
+    if (len < 0) {
+        len = 0;
+    }
+    *span = (char *)&rb->buffer[tail];
+    return len;
+}
 
-    nvic_clear_pending(UART_IRQ_NUMBER);
+/**
+ * @brief uart_port_commit: queue the first len bytes of the last
+ * reservation for sending
+ *
+ * len  - bytes actually written, at most what uart_port_reserve() granted
+ */
+void uart_port_commit(uart_port port, int len) {
+    if (port >= UART_PORTS) {
+        return;
+    }
+    tx_commit(port, uart_state[port].tx.tail, (len > 0) ? len : 0);
 }
+
+/**
+ * @brief uart_port_readline_nb: take the oldest finished input line
+ *
+ * Never waits. The line keeps its '\n' (none after Ctrl-D) and is cut
+ * to len - 1 characters.
+ *
+ * port  - port
+ * ptr   - destination, NUL terminated
+ * len   - size of ptr
+ *
+ * returns the length of the line, 0 when no line is ready
+ */
+int uart_port_readline_nb(uart_port port, char *ptr, int len) {
+    if (port >= UART_PORTS) {
+        return 0;
+    }
+    LineQueue *lq = &uart_state[port].lines;
+    if (len <= 0 || lq->tail == lq->head) {
+        return 0;
+    }
+    const char *src = lq->line[lq->tail & (UART_LINE_QUEUE - 1)];
+    int n = 0;
+    while (src[n] != '\0' && n < len - 1) {
+        ptr[n] = src[n];
+        n++;
+    }
+    ptr[n] = '\0';
+    lq->tail++;
+
+    if (uart_state[port].flow) {
+        // a slot is free again, pick up input held back for it
+        uint32_t primask = irq_save();
+        rx_lines(port);
+        rx_flow(port);
+        irq_restore(primask);
+    }
+    return n;
+}
+
+/**
+ * @brief uart_port_flow_control: turn RTS/CTS flow control on or off
+ *
+ * The CTS pin is handed to the USART, the RTS pin becomes an output,
+ * asserted (low) while there is room. Turning it off leaves RTS asserted.
+ *
+ * port            - port, already opened
+ * enabled         - 1 to turn on, 0 to turn off
+ * high_watermark  - unread bytes at which RTS is deasserted, 0 for the
+ *                   default; see UART_RTS_DEFAULT for the limit
+ *
+ * returns 0 on success or -1 when the port has no flow control pins or
+ * they are in use
+ */
+int uart_port_flow_control(uart_port port, int enabled, uint16_t high_watermark) {
+    if (port >= UART_PORTS || !uart_hw[port].has_flow || high_watermark >= UART_RX_SIZE) {
+        return -1;
+    }
+    if (enabled && !uart_hw_pins_free(port, 1)) {
+        return -1;
+    }
+    const UartHw *hw = &uart_hw[port];
+    UartState *st = &uart_state[port];
+    struct uart_reg_map *uart = hw->base;
+
+    if (enabled) {
+        // an unconnected CTS reads as clear to send
+        gpio_init(hw->cts_port, hw->cts_pin, MODE_ALT, OUTPUT_PUSH_PULL, OUTPUT_SPEED_LOW, PUPD_PULL_DOWN, hw->alt);
+        gpio_init(hw->rts_port, hw->rts_pin, MODE_GP_OUTPUT, OUTPUT_PUSH_PULL, OUTPUT_SPEED_LOW, PUPD_NONE, ALT0);
+        gpio_clr(hw->rts_port, hw->rts_pin);
+    }
+    uint32_t primask = irq_save();
+    st->rts_high = high_watermark ? high_watermark : UART_RTS_DEFAULT;
+    st->rts_off = 0;
+    st->flow = enabled ? 1 : 0;
+    if (enabled) {
+        uart->CR3 |= UART_CR3_CTSE;
+        rx_flow(port);
+    } else {
+        uart->CR3 &= ~UART_CR3_CTSE;
+        gpio_clr(hw->rts_port, hw->rts_pin);
+        // lines held back for the queue are handled the usual way again
+        rx_lines(port);
+    }
+    irq_restore(primask);
+    return 0;
+}
+
+/**
+ * @brief uart_log_drain: move the log queue into the console transmit
+ * ring, called from PendSV
+ *
+ * When a thread writer owns the tail its commit does it instead.
+ */
+void uart_log_drain(void) {
+    UartState *st = &uart_state[UART_CONSOLE];
+    uint32_t primask = irq_save();
+    // nothing can be sent before uart_port_init() has finished
+    if ((uart_hw[UART_CONSOLE].base->CR1 & UART_EN) && !st->tx_busy) {
+        echo_flush(UART_CONSOLE);
+    }
+    irq_restore(primask);
+}
+
+/**
+ * @brief uart_port_stats: read the receive counters of a port
+ *
+ * port   - port
+ * stats  - filled with the counters since the port was opened
+ *
+ * returns 0 on success or -1 on failure
+ */
+int uart_port_stats(uart_port port, uart_stats_t *stats) {
+    if (port >= UART_PORTS || stats == NULL) {
+        return -1;
+    }
+    UartState *st = &uart_state[port];
+    uint32_t primask = irq_save();
+    stats->received = st->rx.received;
+    stats->ring_full = st->rx.lost;
+    stats->lines_dropped = st->lines.dropped;
+    stats->overrun = st->rx.overrun;
+    stats->framing = st->rx.framing;
+    stats->noise = st->rx.noise;
+    irq_restore(primask);
+    return 0;
+}
+
+/**
+ * @brief uart_port_line_mode: turn the interrupt driven line discipline on
+ * or off; when off, received bytes are left for uart_port_get_byte()
+ */
+void uart_port_line_mode(uart_port port, int enabled) {
+    if (port < UART_PORTS) {
+        uart_state[port].line_mode = enabled ? 1 : 0;
+    }
+}
+
+/**
+ * @brief uart_init: open the console port
+ * baud  - baud rate
+ */
+void uart_init(UNUSED int baud) {
+    uart_port_init(UART_CONSOLE, baud);
+}
+
+/**
+ * @brief uart_set_baud: switch the console baud rate, see uart_port_set_baud()
+ */
+int uart_set_baud(uint32_t baud, uint32_t *actual) {
+    return uart_port_set_baud(UART_CONSOLE, baud, actual);
+}
+
+/**
+ * @brief uart_get_baud: console baud rate
+ */
+uint32_t uart_get_baud(void) {
+    return uart_port_get_baud(UART_CONSOLE);
+}
+
+/**
+ * @brief uart_put_byte: transmits a byte over UART
+ * c  - character to be sent
+ *
+ * returns 0 on success or -1 when the transmit ring is full
+ */
+int uart_put_byte(UNUSED char c) {
+    return (uart_port_write(UART_CONSOLE, &c, 1) == 1) ? 0 : -1;
+}
+
+/**
+ * @brief uart_get_byte: receives a byte over UART
+ * c  - character to be sent
+ */
+int uart_get_byte(UNUSED char *c) {
+    return uart_port_get_byte(UART_CONSOLE, c);
+}
+
+/**
+ * @brief uart_write: support writing to stdout and return −1 if this is not the case
+ *
+ * returns the number of bytes queued, see uart_port_write()
+ */
+int uart_write(UNUSED int file, UNUSED char *ptr, UNUSED int len) {
+    if (file != STDOUT_FILENO) {
+        return -1;
+    }
+    return uart_port_write(UART_CONSOLE, ptr, len);
+}
+
+/**
+ * @brief uart_write_reserve: uart_port_reserve() on the console
+ */
+int uart_write_reserve(char **span, int len) {
+    return uart_port_reserve(UART_CONSOLE, span, len);
+}
+
+/**
+ * @brief uart_write_commit: uart_port_commit() on the console
+ */
+void uart_write_commit(int len) {
+    uart_port_commit(UART_CONSOLE, len);
+}
+
+/**
+ * @brief uart_readline_nb: uart_port_readline_nb() on the console
+ */
+int uart_readline_nb(char *ptr, int len) {
+    return uart_port_readline_nb(UART_CONSOLE, ptr, len);
+}
+
+/**
+ * @brief uart_line_mode: uart_port_line_mode() on the console
+ */
+void uart_line_mode(int enabled) {
+    uart_port_line_mode(UART_CONSOLE, enabled);
+}
+
+/**
+ * @brief uart_read: support reading from stdin and return −1 if this is not the case
+ *
+ * Waits for the next console line, see uart_readline_nb() for the version
+ * that does not.
+ */
+int uart_read(UNUSED int file, char *ptr, int len) {
+    if (file != STDIN_FILENO) {
+        return -1;
+    }
+    int n;
+    while ((n = uart_readline_nb(ptr, len)) == 0);
+    return n;
+}
+
+/*
+ * Vector table entries, one line each. A new port needs its uart_hw[]
+ * entry and these three handlers in boot.S.
+ */
+
+/** @brief USART1 global interrupt */
+void usart1_irq_handler() { usart_irq(UART_1); }
+/** @brief USART1_TX, DMA2 stream 7 */
+void dma2_stream7_irq_handler() { tx_dma_irq(UART_1); }
+/** @brief USART1_RX, DMA2 stream 5 */
+void dma2_stream5_irq_handler() { rx_dma_irq(UART_1); }
+
+/** @brief USART2 global interrupt */
+void usart2_irq_handler() { usart_irq(UART_2); }
+/** @brief USART2_TX, DMA1 stream 6 */
+void dma1_stream6_irq_handler() { tx_dma_irq(UART_2); }
+/** @brief USART2_RX, DMA1 stream 5 */
+void dma1_stream5_irq_handler() { rx_dma_irq(UART_2); }
+
+/** @brief USART6 global interrupt */
+void usart6_irq_handler() { usart_irq(UART_6); }
+/** @brief USART6_TX, DMA2 stream 6 */
+void dma2_stream6_irq_handler() { tx_dma_irq(UART_6); }
+/** @brief USART6_RX, DMA2 stream 1 */
+void dma2_stream1_irq_handler() { rx_dma_irq(UART_6); }
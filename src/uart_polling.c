@@ -3,70 +3,42 @@
 #include <rcc.h>
 #include <unistd.h>
 #include <uart_polling.h>
-
-/** @brief The UART register map. */
-struct uart_reg_map {
-    volatile uint32_t SR;   /**< Status Register */
-    volatile uint32_t DR;   /**<  Data Register */
-    volatile uint32_t BRR;  /**<  Baud Rate Register */
-    volatile uint32_t CR1;  /**<  Control Register 1 */
-    volatile uint32_t CR2;  /**<  Control Register 2 */
-    volatile uint32_t CR3;  /**<  Control Register 3 */
-    volatile uint32_t GTPR; /**<  Guard Time and Prescaler Register */
-};
-
-/** @brief Base address for UART2 */
-#define UART2_BASE  (struct uart_reg_map *) 0x40004400
-
-/** @brief Enable Bit for UART Config register */
-#define UART_EN (1 << 13)
-
-/** @brief Pre calculated UARTDIV value for desired band rate of 115200 bps by default */
-#define UARTDIV 0x8B
-
-/** @brief Enable Bit for Transmitter */
-#define UART_TE (1 << 3)
-
-/** @brief Enable Bit for Receiver */
-#define UART_RE (1 << 2)
-
-/** @brief Transmit data register empty */
-#define UART_SR_TXE (1 << 7)
-
-/** @brief Read data registter not empty */
-#define UART_SR_RXNE (1 << 5)
+#include <uart_hw.h>
 
 /**
  * @brief initializes UART to given baud rate with 8-bit word length, 1 stop bit, 0 parity bits
  *
+ * @param port Port to open, left alone when another driver uses its pins
  * @param baud Baud rate
  */
-void uart_polling_init (int baud){
-    if (baud == 0) {
+void uart_polling_init (uart_port port, int baud){
+    uint32_t brr, over8, actual;
+    if (port >= UART_PORTS || baud <= 0 || uart_hw_brr(port, baud, &brr, &over8, &actual) != 0) {
+        return;
+    }
+    // same check as uart_port_init()
+    if (!uart_hw_pins_free(port, 0)) {
         return;
     }
-    struct uart_reg_map *uart = UART2_BASE;
-    // Reset and Clock Control
-    struct rcc_reg_map *rcc = RCC_BASE;
-    rcc->apb1_enr |= UART_CLKEN;
-    // GPIO Pins
-    gpio_init(GPIO_A, 2, MODE_ALT, OUTPUT_PUSH_PULL, OUTPUT_SPEED_LOW, PUPD_NONE, ALT7);        /* PA_2 for TX line UART2 */
-    gpio_init(GPIO_A, 3, MODE_ALT, OUTPUT_OPEN_DRAIN, OUTPUT_SPEED_LOW, PUPD_NONE, ALT7);       /* PA_2 for RX line UART2 */
-    
+    struct uart_reg_map *uart = uart_hw[port].base;
+    // Reset and Clock Control, GPIO Pins
+    uart_hw_setup(port);
+
     // Initialize UART to the desired Baud Rate
-    uart->BRR = UARTDIV;
+    uart->BRR = brr;
     // UART Control Registers
-    uart->CR1 |= (UART_TE | UART_RE | UART_EN);
+    uart->CR1 |= (over8 | UART_TE | UART_RE | UART_EN);
     return;
 }
 
 /**
  * @brief transmits a byte over UART
  *
+ * @param port Port
  * @param c character to be sent
  */
-void uart_polling_put_byte (char c){
-    struct uart_reg_map *uart = UART2_BASE;
+void uart_polling_put_byte (uart_port port, char c){
+    struct uart_reg_map *uart = uart_hw[port].base;
     // Wait the data register to be empty
     while (!((uart->SR) & UART_SR_TXE)){};
     // Once ready, write and return
@@ -76,9 +48,11 @@ void uart_polling_put_byte (char c){
 
 /**
  * @brief receives a byte over UART
+ *
+ * @param port Port
  */
-char uart_polling_get_byte (){
-    struct uart_reg_map *uart = UART2_BASE;
+char uart_polling_get_byte (uart_port port){
+    struct uart_reg_map *uart = uart_hw[port].base;
     // Wait until ready to be read
     while (!(uart->SR & UART_SR_RXNE)){};
     // return received data
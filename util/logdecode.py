@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""Turn the console output of a LOG=bin build back into text.
+
+Reads the console from a serial port, a capture file or stdin. Ordinary
+text is passed through, LOG() records (see include/log.h) are formatted
+with the format strings from the .logstr section of the ELF, and %s
+arguments are read from the loaded sections of the same ELF.
+
+    python3 util/logdecode.py build/bin/lab3_<hash>.elf /dev/ttyACM0
+    python3 util/logdecode.py --no-time lab3.elf capture.bin
+    tail -f build/swo.bin | python3 util/logdecode.py --itm lab3.elf
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+LOG_SYNC = 0xF8
+LOG_HEADER = 7
+
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+
+
+class Elf:
+    """The sections of a little endian 32 bit ELF file that the decoder needs."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ValueError("%s is not a little endian 32 bit ELF" % path)
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x2E)
+
+        headers = [struct.unpack_from("<IIIIIIIIII", data, shoff + i * shentsize)
+                   for i in range(shnum)]
+        names = headers[shstrndx]
+        self.logstr = b""
+        # (address, bytes) of every section the board has in memory
+        self.loaded = []
+        for name, kind, flags, addr, offset, size, _, _, _, _ in headers:
+            start = names[4] + name
+            name = data[start:data.index(b"\0", start)].decode()
+            if name == ".logstr":
+                self.logstr = data[offset:offset + size]
+            elif flags & SHF_ALLOC and kind != SHT_NOBITS:
+                self.loaded.append((addr, data[offset:offset + size]))
+        if not self.logstr:
+            raise ValueError("%s has no .logstr section, build it with LOG=bin" % path)
+
+    def format(self, fmt_id):
+        end = self.logstr.find(b"\0", fmt_id)
+        return self.logstr[fmt_id:end].decode("latin-1")
+
+    def string(self, addr):
+        for base, blob in self.loaded:
+            if base <= addr < base + len(blob):
+                end = blob.find(b"\0", addr - base)
+                return blob[addr - base:end].decode("latin-1")
+        return "<0x%08x>" % addr
+
+
+def printk_format(elf, fmt, args):
+    """Format like printk(): %d %u %o %x %p %s %c and %%, with the 0 and -
+    flags, a width and the l size. Records carry 32 bit arguments, LOG()
+    rejects wider ones, so ll is read as l."""
+    args = iter(args)
+
+    def conv(m):
+        flags, width, c = m.group(1), int(m.group(2) or 0), m.group(4)
+        if c == "%":
+            return "%"
+        v = next(args, 0)
+        prefix = ""
+        if c == "d":
+            if v & 0x80000000:
+                prefix, v = "-", (1 << 32) - v
+            text = str(v)
+        elif c == "u":
+            text = str(v)
+        elif c == "o":
+            prefix, text = "0", "%o" % v
+        elif c in "xp":
+            prefix, text = "0x", "%x" % v
+        elif c == "s":
+            text = elf.string(v)
+        else:
+            text = chr(v & 0xFF)
+        pad = max(width - len(prefix) - len(text), 0)
+        # '-' wins over '0', and strings are never zero padded
+        if "-" in flags:
+            return prefix + text + " " * pad
+        if "0" in flags and c not in "sc":
+            return prefix + "0" * pad + text
+        return " " * pad + prefix + text
+
+    return re.sub(r"%([-0]*)(\d*)(l{0,2})([duoxpsc%])", conv, fmt)
+
+
+class Output:
+    """Text destination that knows whether the next write starts a line."""
+
+    def __init__(self, out, show_time):
+        self.out = out
+        self.show_time = show_time
+        self.at_line_start = True
+
+    def write(self, text, ms=None):
+        if ms is not None and self.show_time and self.at_line_start:
+            text = "[%6d.%03d] " % (ms // 1000, ms % 1000) + text
+        if text:
+            self.out.write(text)
+            self.at_line_start = text.endswith("\n")
+
+
+class Decoder:
+    """Splits one byte stream into text and LOG() records."""
+
+    def __init__(self, elf, out):
+        self.elf = elf
+        self.out = out
+        self.pending = bytearray()
+
+    def feed(self, data):
+        pending = self.pending
+        pending += data
+        while pending:
+            sync = pending[0]
+            if sync < LOG_SYNC:
+                # text up to the next record
+                end = next((i for i, b in enumerate(pending) if b >= LOG_SYNC), len(pending))
+                self.out.write(pending[:end].decode("latin-1"))
+                del pending[:end]
+                continue
+            argc = sync & 7
+            size = LOG_HEADER + 4 * argc
+            if len(pending) < size:
+                break
+            fmt_id, ms = struct.unpack_from("<HI", pending, 1)
+            args = struct.unpack_from("<%dI" % argc, pending, LOG_HEADER)
+            del pending[:size]
+            self.out.write(printk_format(self.elf, self.elf.format(fmt_id), args), ms)
+
+
+class ItmSplitter:
+    """Takes the stimulus port payloads out of a raw SWO capture.
+
+    Packets are described in appendix D of the ARMv7-M architecture
+    reference manual; everything but software source packets is skipped.
+    """
+
+    def __init__(self, sinks):
+        # port -> object with feed()
+        self.sinks = sinks
+        self.pending = bytearray()
+
+    def feed(self, data):
+        pending = self.pending
+        pending += data
+        while pending:
+            c = pending[0]
+            if c == 0:
+                # synchronization, zeros up to a 0x80
+                end = next((i for i, b in enumerate(pending) if b != 0), None)
+                if end is None:
+                    del pending[:-1]
+                    break
+                del pending[:end + 1]
+                continue
+            if c & 3 == 0:
+                # timestamp, overflow or extension, continuation bit 7
+                end = 0
+                while pending[end] & 0x80:
+                    end += 1
+                    if end == len(pending):
+                        return
+                del pending[:end + 1]
+                continue
+            size = 4 if c & 3 == 3 else c & 3
+            if len(pending) < 1 + size:
+                break
+            payload = bytes(pending[1:1 + size])
+            del pending[:1 + size]
+            # bit 2 marks hardware (DWT) packets
+            if not c & 4 and (c >> 3) in self.sinks:
+                self.sinks[c >> 3].feed(payload)
+
+
+def decode(stream, sink, out):
+    while True:
+        # whatever has arrived, without waiting for a full block
+        chunk = getattr(stream, "read1", stream.read)(4096)
+        if not chunk:
+            break
+        sink.feed(chunk)
+        out.out.flush()
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    f = open(path, "rb", buffering=0)
+    if os.isatty(f.fileno()):
+        import termios
+        import tty
+        tty.setraw(f.fileno())
+        attrs = termios.tcgetattr(f.fileno())
+        speed = getattr(termios, "B%d" % baud)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(f.fileno(), termios.TCSANOW, attrs)
+    return f
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="ELF of the running build")
+    parser.add_argument("input", nargs="?", default="-",
+                        help="serial port or capture file, stdin by default")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--no-time", action="store_true",
+                        help="leave out the board time in front of records")
+    parser.add_argument("--itm", action="store_true",
+                        help="input is a raw SWO capture (make swo), printk() text on "
+                             "ITM port 0 and LOG() records on port 1")
+    opts = parser.parse_args()
+
+    try:
+        elf = Elf(opts.elf)
+        out = Output(sys.stdout, not opts.no_time)
+        if opts.itm:
+            # one decoder per port, a record can be split by text from an interrupt
+            sink = ItmSplitter({0: Decoder(elf, out), 1: Decoder(elf, out)})
+        else:
+            sink = Decoder(elf, out)
+        decode(open_input(opts.input, opts.baud), sink, out)
+    except (OSError, ValueError) as e:
+        sys.exit("logdecode: %s" % e)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
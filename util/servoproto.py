@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+"""Drive the servos over the binary packet protocol (include/proto.h).
+
+Switches the console to packets with the proto command, then sends one
+request or, with bench, keeps a window of requests in flight and reports
+how many acknowledged commands per second the link carries. A request
+without a reply is resent, as the board drops damaged packets silently.
+Channels are numbered from 0.
+
+    python3 util/servoproto.py /dev/ttyACM0 enable 0
+    python3 util/servoproto.py /dev/ttyACM0 move 0 45 120 360 1800
+    python3 util/servoproto.py --baud 921600 /dev/ttyACM0 bench 5000
+    python3 util/servoproto.py /dev/ttyACM0 text
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import time
+
+OP_PING = 0x00
+OP_ENABLE = 0x01
+OP_DISABLE = 0x02
+OP_SET = 0x03
+OP_MOVE = 0x04
+OP_QUERY = 0x05
+OP_STATS = 0x06
+OP_TEXT = 0x7F
+REPLY = 0x80
+
+STATUS = {0: "ok", 1: "unknown opcode", 2: "bad length", 3: "rejected"}
+
+# the board drops damaged packets without a reply, so a request without a
+# reply after RETRY_S is sent again, up to RETRIES times
+RETRY_S = 0.2
+RETRIES = 5
+
+
+def crc32(data):
+    """CRC of a packet like frame_crc() in proto.c: CRC-32/MPEG-2 of little
+    endian words, the last zero padded, then of the length as a word."""
+    data = bytes(data) + bytes(-len(data) % 4) + struct.pack("<I", len(data))
+    crc = 0xFFFFFFFF
+    for (word,) in struct.iter_unpack("<I", data):
+        crc ^= word
+        for _ in range(32):
+            crc = ((crc << 1) ^ 0x04C11DB7 if crc & 0x80000000 else crc << 1) & 0xFFFFFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_at = 0
+    for b in data:
+        if b == 0:
+            out[code_at] = len(out) - code_at
+            code_at = len(out)
+            out.append(0)
+            continue
+        out.append(b)
+        if len(out) - code_at == 0xFF:
+            out[code_at] = 0xFF
+            code_at = len(out)
+            out.append(0)
+    out[code_at] = len(out) - code_at
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS")
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class Link:
+    """Packets over a raw serial port, many requests in flight."""
+
+    def __init__(self, path, baud):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        if os.isatty(self.fd):
+            import termios
+            import tty
+            tty.setraw(self.fd)
+            attrs = termios.tcgetattr(self.fd)
+            speed = getattr(termios, "B%d" % baud)
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        self.pending = bytearray()
+        self.seq = 0
+        self.dropped = 0
+        self.retries = 0
+
+    def enter(self):
+        """Switch the console to packets, wait until it answers a ping."""
+        os.write(self.fd, b"\nproto\n")
+        for _ in range(20):
+            time.sleep(0.05)
+            self.drain()
+            self.send(OP_PING)
+            try:
+                return self.receive(0.1)
+            except TimeoutError:
+                continue
+        raise TimeoutError("no reply to ping, is the board running?")
+
+    def drain(self):
+        while select.select([self.fd], [], [], 0)[0]:
+            os.read(self.fd, 4096)
+        self.pending.clear()
+
+    def send(self, op, payload=b"", seq=None):
+        """Queue a request, return its sequence number; pass seq to resend one."""
+        if seq is None:
+            seq = self.seq
+            self.seq = (self.seq + 1) & 0xFF
+        pkt = bytes([seq, op]) + payload
+        os.write(self.fd, b"\0" + cobs_encode(pkt + struct.pack("<I", crc32(pkt))) + b"\0")
+        return seq
+
+    def receive(self, timeout=1.0):
+        """Next valid reply as (seq, op, status, payload)."""
+        deadline = time.monotonic() + timeout
+        while True:
+            while b"\0" in self.pending:
+                end = self.pending.index(b"\0")
+                chunk = bytes(self.pending[:end])
+                del self.pending[:end + 1]
+                if not chunk:
+                    continue
+                try:
+                    pkt = cobs_decode(chunk)
+                except ValueError:
+                    pkt = b""
+                # console text between packets fails here too
+                if len(pkt) < 7 or crc32(pkt[:-4]) != struct.unpack("<I", pkt[-4:])[0]:
+                    self.dropped += 1
+                    continue
+                return pkt[0], pkt[1] & ~REPLY, pkt[2], pkt[3:-4]
+            left = deadline - time.monotonic()
+            if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+                raise TimeoutError("no reply")
+            self.pending += os.read(self.fd, 4096)
+
+    def request(self, op, payload=b""):
+        """Send a request and wait for its reply, resending it as needed."""
+        seq = self.send(op, payload)
+        for attempt in range(RETRIES + 1):
+            if attempt > 0:
+                self.retries += 1
+                self.send(op, payload, seq)
+            deadline = time.monotonic() + RETRY_S
+            try:
+                while True:
+                    rseq, rop, status, data = self.receive(max(deadline - time.monotonic(), 0))
+                    if rseq == seq and rop == op:
+                        return status, data
+            except TimeoutError:
+                continue
+        raise TimeoutError("no reply after %d retries" % RETRIES)
+
+
+def bench(link, count, window, channel):
+    """Sweep a channel with set requests, window of them in flight."""
+    sent = done = errors = 0
+    # sequence number -> [resend deadline, payload, retries]
+    inflight = {}
+    start = time.monotonic()
+    while done < count:
+        # a request that keeps failing must not share its number with a new one
+        while sent < count and len(inflight) < window and link.seq not in inflight:
+            payload = struct.pack("<BH", channel, (sent * 7) % 1801)
+            seq = link.send(OP_SET, payload)
+            inflight[seq] = [time.monotonic() + RETRY_S, payload, 0]
+            sent += 1
+        now = time.monotonic()
+        for seq, req in inflight.items():
+            if req[0] <= now:
+                if req[2] == RETRIES:
+                    raise TimeoutError("no reply to request %d after %d retries" % (seq, RETRIES))
+                req[0] = now + RETRY_S
+                req[2] += 1
+                link.retries += 1
+                link.send(OP_SET, req[1], seq)
+        try:
+            seq, op, status, _ = link.receive(RETRY_S)
+        except TimeoutError:
+            continue
+        if op != OP_SET or inflight.pop(seq, None) is None:
+            continue
+        done += 1
+        if status != 0:
+            errors += 1
+    elapsed = time.monotonic() - start
+    print("%d commands in %.3f s, %.0f/s, %d rejected, %d bad packets, %d resent"
+          % (count, elapsed, count / elapsed, errors, link.dropped, link.retries))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="console serial port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--window", type=int, default=32,
+                        help="requests in flight for bench, at most 256")
+    parser.add_argument("command", choices=["ping", "enable", "disable", "set", "move",
+                                            "query", "stats", "text", "bench"])
+    parser.add_argument("args", nargs="*", type=int)
+    opts = parser.parse_args()
+
+    try:
+        link = Link(opts.port, opts.baud)
+        link.enter()
+        a = opts.args
+        if opts.command == "bench":
+            bench(link, a[0] if a else 1000, min(opts.window, 256), a[1] if len(a) > 1 else 0)
+            return
+        op, fmt = {
+            "ping": (OP_PING, ""), "enable": (OP_ENABLE, "<B"), "disable": (OP_DISABLE, "<B"),
+            "set": (OP_SET, "<BH"), "move": (OP_MOVE, "<BBHHH"), "query": (OP_QUERY, "<B"),
+            "stats": (OP_STATS, ""), "text": (OP_TEXT, ""),
+        }[opts.command]
+        status, data = link.request(op, struct.pack(fmt, *a))
+        print(STATUS.get(status, "status %d" % status))
+        if op == OP_QUERY and status == 0:
+            enabled, moving, decideg = struct.unpack("<BBH", data)
+            print("enabled %d moving %d position %d.%d deg"
+                  % (enabled, moving, decideg // 10, decideg % 10))
+        elif op == OP_STATS:
+            print("requests %d crc errors %d framing errors %d" % struct.unpack("<III", data))
+    except (OSError, ValueError, TimeoutError, struct.error) as e:
+        sys.exit("servoproto: %s" % e)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()